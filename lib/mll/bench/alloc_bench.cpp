@@ -0,0 +1,41 @@
+#include <catch2/catch.hpp>
+
+#include <mll/alloc.hpp>
+#include <mll/list.hpp>
+#include <mll/symbol.hpp>
+
+namespace mll {
+
+namespace {
+List make_list(int count)
+{
+    Node const item{Symbol{"item"}};
+    List list;
+    for (int i = 0; i < count; ++i) {
+        list = cons(item, list);
+    }
+    return list;
+}
+} // namespace
+
+TEST_CASE("cons cell allocation", "[!benchmark]")
+{
+    BENCHMARK("cons 100k cells")
+    {
+        return length(make_list(100'000));
+    };
+
+    auto const list = make_list(100'000);
+    BENCHMARK("map over 100k cells")
+    {
+        return length(map(list, [](auto const& node) { return node; }));
+    };
+
+    BENCHMARK("cons 100k cells in a region")
+    {
+        AllocationRegion region;
+        return length(make_list(100'000));
+    };
+}
+
+} // namespace mll
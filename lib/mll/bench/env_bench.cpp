@@ -0,0 +1,69 @@
+#include <catch2/catch.hpp>
+
+#include <mll/env.hpp>
+#include <mll/symbol.hpp>
+
+#include <string>
+#include <vector>
+
+namespace mll {
+
+namespace {
+// A chain of `depth` derived envs below a root with 100 globals, each env
+// with 4 bindings of its own, as macro and `define` frames have.
+std::shared_ptr<Env> make_chain(int depth)
+{
+    auto env = Env::create();
+    for (int i = 0; i < 100; ++i) {
+        env->set("env-bench-global-" + std::to_string(i), Symbol{"value"});
+    }
+    for (int d = 0; d < depth; ++d) {
+        env = env->derive_new();
+        for (int i = 0; i < 4; ++i) {
+            env->set("env-bench-local-" + std::to_string(i), Symbol{"value"});
+        }
+    }
+    return env;
+}
+} // namespace
+
+TEST_CASE("Env lookup at several frame depths", "[Env]")
+{
+    for (auto depth : {0, 1, 4, 16}) {
+        auto const env = make_chain(depth);
+        Symbol const global{"env-bench-global-50"};
+        auto const suffix = ", " + std::to_string(depth) + " frames deep";
+
+        BENCHMARK("1000 lookups of a global" + suffix)
+        {
+            std::size_t found = 0;
+            for (int i = 0; i < 1000; ++i) {
+                found += env->deep_lookup(global).has_value();
+            }
+            return found;
+        };
+
+        BENCHMARK("1000 lookups of a global by name" + suffix)
+        {
+            std::size_t found = 0;
+            for (int i = 0; i < 1000; ++i) {
+                found += env->deep_lookup("env-bench-global-50").has_value();
+            }
+            return found;
+        };
+
+        if (depth > 0) {
+            Symbol const local{"env-bench-local-3"};
+            BENCHMARK("1000 lookups of a local" + suffix)
+            {
+                std::size_t found = 0;
+                for (int i = 0; i < 1000; ++i) {
+                    found += env->deep_lookup(local).has_value();
+                }
+                return found;
+            };
+        }
+    }
+}
+
+} // namespace mll
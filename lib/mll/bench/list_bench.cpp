@@ -0,0 +1,64 @@
+#include <catch2/catch.hpp>
+
+#include <mll/custom.hpp>
+#include <mll/list.hpp>
+#include <mll/proc.hpp>
+#include <mll/symbol.hpp>
+
+namespace mll {
+
+namespace {
+List make_list(int count)
+{
+    Node const item{Symbol{"item"}};
+    List list;
+    for (int i = 0; i < count; ++i) {
+        list = cons(i % 2 ? item : Node{cons(item, nil)}, list);
+    }
+    return list;
+}
+
+struct CountingVisitor : NodeVisitor {
+    void visit(List const&) override
+    {
+        ++lists;
+    }
+    void visit(Proc const&) override
+    {}
+    void visit(Symbol const&) override
+    {
+        ++symbols;
+    }
+    void visit(Custom const&) override
+    {}
+
+    size_t lists = 0;
+    size_t symbols = 0;
+};
+} // namespace
+
+TEST_CASE("List traversal", "[!benchmark]")
+{
+    auto const list = make_list(100'000);
+
+    BENCHMARK("length of 100k cells")
+    {
+        return length(list);
+    };
+
+    BENCHMARK("car/cdr walk over 100k cells")
+    {
+        size_t lists = 0;
+        for_each(list, [&lists](Node const& node) { lists += dynamic_node_cast<List>(node).has_value(); });
+        return lists;
+    };
+
+    BENCHMARK("accept() over 100k cells")
+    {
+        CountingVisitor visitor;
+        for_each(list, [&visitor](Node const& node) { node.accept(visitor); });
+        return visitor.lists + visitor.symbols;
+    };
+}
+
+} // namespace mll
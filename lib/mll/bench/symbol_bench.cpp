@@ -0,0 +1,70 @@
+#include <catch2/catch.hpp>
+
+#include <mll/symbol.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mll {
+
+namespace {
+std::vector<std::string> make_names(std::string const& prefix, int count)
+{
+    std::vector<std::string> names;
+    for (int i = 0; i < count; ++i) {
+        names.push_back(prefix + std::to_string(i));
+    }
+    return names;
+}
+
+void intern_all(std::vector<std::string> const& names, int rounds)
+{
+    for (int r = 0; r < rounds; ++r) {
+        for (auto const& name : names) {
+            Symbol{name};
+        }
+    }
+}
+
+void intern_on_threads(std::vector<std::vector<std::string>> const& names_per_thread, int rounds)
+{
+    std::vector<std::thread> threads;
+    for (auto const& names : names_per_thread) {
+        threads.emplace_back([&names, rounds] { intern_all(names, rounds); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+} // namespace
+
+TEST_CASE("Symbol interning throughput", "[Symbol]")
+{
+    auto const names = make_names("bench-", 1000);
+    intern_all(names, 1);
+
+    BENCHMARK("100k lookups of existing names, 1 thread")
+    {
+        intern_all(names, 100);
+    };
+
+    BENCHMARK("100k lookups of existing names per thread, 4 threads")
+    {
+        intern_on_threads({names, names, names, names}, 100);
+    };
+
+    BENCHMARK_ADVANCED("1000 new names per thread, 4 threads")(Catch::Benchmark::Chronometer meter)
+    {
+        static int round = 0;
+        std::vector<std::vector<std::vector<std::string>>> names_per_run(meter.runs());
+        for (auto& names_per_thread : names_per_run) {
+            for (int t = 0; t < 4; ++t) {
+                names_per_thread.push_back(make_names("new-" + std::to_string(round++) + "-", 1000));
+            }
+        }
+        meter.measure([&names_per_run](int run) { intern_on_threads(names_per_run[run], 1); });
+    };
+}
+
+} // namespace mll
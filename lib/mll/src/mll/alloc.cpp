@@ -0,0 +1,262 @@
+#include <mll/alloc.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h> // _aligned_malloc
+#endif
+
+namespace mll {
+
+namespace {
+
+// Every small allocation lives in a chunk aligned to `chunk_size`, so the
+// chunk header of any core is found by masking its address. Larger ones come
+// from operator new; the size they are freed with tells them apart.
+constexpr std::size_t chunk_size = 64 * 1024;
+constexpr std::size_t granule = alignof(std::max_align_t);
+constexpr std::size_t size_class_count = 16;
+constexpr std::size_t max_small_size = granule * size_class_count;
+
+enum class ChunkKind { pool, region };
+
+// Added to `shared_refs` while a region allocates from the chunk, so that the
+// count cannot drop to zero before `retire_chunk()` folds in `owner_refs`.
+constexpr std::ptrdiff_t open_bias = PTRDIFF_MAX / 2;
+
+struct ChunkHeader {
+    ChunkKind const kind;
+
+    // Region chunks only. Cores freed by the owning thread while the chunk is
+    // open are counted without atomics; every other free goes to `shared_refs`.
+    void const* const owner;
+    bool open = true;
+    std::ptrdiff_t owner_refs = 0;
+    std::atomic<std::ptrdiff_t> shared_refs{open_bias};
+};
+
+constexpr std::size_t round_up(std::size_t size, std::size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+constexpr std::size_t header_size = round_up(sizeof(ChunkHeader), granule);
+
+// MSVC has no std::aligned_alloc; its aligned blocks need _aligned_free.
+void* allocate_chunk_memory()
+{
+#ifdef _MSC_VER
+    return _aligned_malloc(chunk_size, chunk_size);
+#else
+    return std::aligned_alloc(chunk_size, chunk_size);
+#endif
+}
+
+void free_chunk_memory(void* mem)
+{
+#ifdef _MSC_VER
+    _aligned_free(mem);
+#else
+    std::free(mem);
+#endif
+}
+
+// Region chunks released on this thread are kept for reuse, up to a limit,
+// and freed when the thread exits.
+struct SpareChunks {
+    static constexpr std::size_t capacity = 32;
+
+    ~SpareChunks()
+    {
+        while (count > 0) {
+            free_chunk_memory(chunks[--count]);
+        }
+    }
+
+    void* chunks[capacity];
+    std::size_t count = 0;
+};
+
+thread_local SpareChunks spare_chunks;
+
+ChunkHeader* new_chunk(ChunkKind kind, void const* owner = nullptr)
+{
+    void* mem;
+    if (kind == ChunkKind::region && spare_chunks.count > 0) {
+        mem = spare_chunks.chunks[--spare_chunks.count];
+    }
+    else {
+        mem = allocate_chunk_memory();
+        if (!mem) {
+            throw std::bad_alloc{};
+        }
+    }
+    return new (mem) ChunkHeader{kind, owner};
+}
+
+void free_chunk(ChunkHeader* chunk)
+{
+    auto const kind = chunk->kind;
+    chunk->~ChunkHeader();
+    if (kind == ChunkKind::region && spare_chunks.count < SpareChunks::capacity) {
+        spare_chunks.chunks[spare_chunks.count++] = chunk;
+        return;
+    }
+    free_chunk_memory(chunk);
+}
+
+void retire_chunk(ChunkHeader* chunk)
+{
+    chunk->open = false;
+    auto const delta = chunk->owner_refs - open_bias;
+    if (chunk->shared_refs.fetch_add(delta, std::memory_order_acq_rel) + delta == 0) {
+        free_chunk(chunk);
+    }
+}
+
+bool is_empty_chunk(ChunkHeader const* chunk)
+{
+    return chunk->owner_refs == open_bias - chunk->shared_refs.load(std::memory_order_acquire);
+}
+
+ChunkHeader* chunk_of(void* ptr)
+{
+    return reinterpret_cast<ChunkHeader*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(chunk_size - 1));
+}
+
+char* payload_of(ChunkHeader* chunk)
+{
+    return reinterpret_cast<char*>(chunk) + header_size;
+}
+
+void* allocate_large(std::size_t size)
+{
+    return ::operator new(size);
+}
+
+// Trivially destructible, so cores freed during thread or process shutdown
+// can still be pushed onto the free lists.
+//
+// Pool chunks are never returned to the system: a thread's pool keeps the most
+// memory its small cores ever took at once, and cores freed onto the free
+// lists are handed out again, last freed first, for cores of the same size
+// class. Finding the chunks whose cells are all free would take a count per
+// chunk on every allocation, and unlinking their cells from the free lists a
+// walk of the lists.
+struct Pool {
+    struct FreeCell {
+        FreeCell* next;
+    };
+
+    void* allocate(std::size_t size)
+    {
+        auto const size_class = (size - 1) / granule;
+        if (auto cell = free_lists[size_class]) {
+            free_lists[size_class] = cell->next;
+            return cell;
+        }
+
+        auto const cell_size = (size_class + 1) * granule;
+        if (static_cast<std::size_t>(end - next) < cell_size) {
+            auto chunk = new_chunk(ChunkKind::pool);
+            next = payload_of(chunk);
+            end = reinterpret_cast<char*>(chunk) + chunk_size;
+        }
+        auto cell = next;
+        next += cell_size;
+        return cell;
+    }
+
+    void deallocate(void* ptr, std::size_t size)
+    {
+        auto const size_class = (size - 1) / granule;
+        free_lists[size_class] = new (ptr) FreeCell{free_lists[size_class]};
+    }
+
+    FreeCell* free_lists[size_class_count];
+    char* next;
+    char* end;
+};
+
+thread_local Pool pool;
+thread_local AllocationRegion* current_region = nullptr;
+
+} // namespace
+
+void* allocate_core(std::size_t size)
+{
+    if (current_region) {
+        return current_region->allocate(size);
+    }
+    if (size > max_small_size) {
+        return allocate_large(size);
+    }
+    return pool.allocate(size);
+}
+
+void deallocate_core(void* ptr, std::size_t size)
+{
+    if (size > max_small_size) {
+        ::operator delete(ptr);
+        return;
+    }
+    auto chunk = chunk_of(ptr);
+    switch (chunk->kind) {
+    case ChunkKind::pool:
+        pool.deallocate(ptr, size);
+        break;
+    case ChunkKind::region:
+        if (chunk->owner == &pool && chunk->open) {
+            --chunk->owner_refs;
+        }
+        else if (chunk->shared_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            free_chunk(chunk);
+        }
+        break;
+    }
+}
+
+AllocationRegion::AllocationRegion() : _previous{current_region}
+{
+    current_region = this;
+}
+
+AllocationRegion::~AllocationRegion()
+{
+    current_region = _previous;
+    if (_chunk) {
+        retire_chunk(static_cast<ChunkHeader*>(_chunk));
+    }
+}
+
+void* AllocationRegion::allocate(std::size_t size)
+{
+    if (size > max_small_size) {
+        return allocate_large(size);
+    }
+    size = round_up(size, granule);
+
+    auto chunk = static_cast<ChunkHeader*>(_chunk);
+    if (chunk && is_empty_chunk(chunk)) {
+        // every core of the current chunk is gone; start over
+        _next = payload_of(chunk);
+    }
+    if (static_cast<std::size_t>(_end - _next) < size) {
+        if (chunk) {
+            retire_chunk(chunk);
+        }
+        chunk = new_chunk(ChunkKind::region, &pool);
+        _chunk = chunk;
+        _next = payload_of(chunk);
+        _end = reinterpret_cast<char*>(chunk) + chunk_size;
+    }
+    ++chunk->owner_refs;
+    auto ptr = _next;
+    _next += size;
+    return ptr;
+}
+
+} // namespace mll
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace mll {
+
+// Node cores (and Env frames) are allocated, together with their reference
+// counts, through `allocate_core()`. By default memory comes from
+// thread-local pools with one free list per 16-byte size class. While an
+// AllocationRegion is active on a thread, that thread bump-allocates from the
+// region's chunks instead. Cores larger than the largest size class come from
+// operator new either way. Cores must be freed with the size they were
+// allocated with.
+//
+// Pools keep the memory of the cores freed to them for reuse by the thread,
+// rather than returning it to the system.
+void* allocate_core(std::size_t size);
+void deallocate_core(void* ptr, std::size_t size);
+
+template <typename T>
+struct CoreAllocator {
+    using value_type = T;
+
+    CoreAllocator() = default;
+
+    template <typename U>
+    CoreAllocator(CoreAllocator<U> const&)
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        static_assert(alignof(T) <= alignof(std::max_align_t));
+        return static_cast<T*>(allocate_core(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, std::size_t n)
+    {
+        deallocate_core(ptr, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(CoreAllocator<U> const&) const
+    {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(CoreAllocator<U> const&) const
+    {
+        return false;
+    }
+};
+
+template <typename T, typename... Args>
+std::shared_ptr<T> make_core(Args&&... args)
+{
+    return std::allocate_shared<T>(CoreAllocator<T>{}, std::forward<Args>(args)...);
+}
+
+// Scopes core allocation on the current thread to a bump arena, typically for
+// one top-level evaluation. Freeing a single core only decrements its chunk's
+// count of live cores; chunks are released in bulk, as soon as the region has
+// moved past them and all of their cores are gone. Cores that outlive the
+// region (e.g. values bound with `define`) stay valid and keep their chunk
+// alive. Regions nest, and must be destroyed on the thread that created them.
+class AllocationRegion final {
+public:
+    AllocationRegion();
+    ~AllocationRegion();
+
+    AllocationRegion(AllocationRegion const&) = delete;
+    AllocationRegion& operator=(AllocationRegion const&) = delete;
+
+    void* allocate(std::size_t size);
+
+private:
+    AllocationRegion* const _previous;
+    void* _chunk = nullptr;
+    char* _next = nullptr;
+    char* _end = nullptr;
+};
+
+} // namespace mll
@@ -0,0 +1,276 @@
+#include <mll/analyze.hpp>
+
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/lambda.hpp>
+#include <mll/list.hpp>
+#include <mll/print.hpp>
+#include <mll/scope.hpp>
+#include <mll/symbol.hpp>
+
+#include <array>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mll {
+
+namespace {
+
+using Codes = std::vector<std::unique_ptr<Code const>>;
+
+Proc to_proc_or_throw(Node const& node)
+{
+    if (auto proc = dynamic_node_cast<Proc>(node)) {
+        return *proc;
+    }
+    throw EvalError(std::to_string(node) + " is not a proc.");
+}
+
+struct ConstantCode final : Code {
+    explicit ConstantCode(Node v) : value{std::move(v)}
+    {}
+
+    Node run(Env& /*env*/, TailCall& /*tail*/) const override
+    {
+        return value;
+    }
+
+    void trace(ReferenceVisitor& visitor) const override
+    {
+        visitor.visit(value);
+    }
+
+    Node const value;
+};
+
+struct SymbolCode final : Code {
+    SymbolCode(Symbol s, Scope::Address a) : sym{std::move(s)}, address{a}
+    {}
+
+    Node run(Env& env, TailCall& /*tail*/) const override
+    {
+        auto value = env.lookup(sym, address, _cache);
+        if (!value.has_value()) {
+            throw EvalError("Unknown symbol: " + sym.name());
+        }
+        return *value;
+    }
+
+    void trace(ReferenceVisitor& visitor) const override
+    {
+        _cache.trace(visitor);
+    }
+
+    Symbol const sym;
+    Scope::Address const address;
+
+private:
+    mutable LookupCache _cache;
+};
+
+struct CallCode final : Code {
+    CallCode(std::unique_ptr<Code const> o, List f, std::shared_ptr<Scope const> s, std::optional<Symbol> n)
+        : op{std::move(o)}, form{std::move(f)}, args{cdr(form)}, scope{std::move(s)}, name{std::move(n)}
+    {}
+
+    Node run(Env& env, TailCall& tail) const override
+    {
+        if (_by_name && bound_special_form(*name) == _special_form) {
+            return run_special(env, tail);
+        }
+
+        auto proc = to_proc_or_throw(execute(*op, env));
+        auto const& core = proc.core();
+
+        if (auto lambda = core->lambda()) {
+            auto const& codes = arg_codes();
+            if (codes.size() < lambda->arity) {
+                throw EvalError("Proc: too few args");
+            }
+            if (codes.size() > lambda->arity && !lambda->variadic) {
+                throw EvalError("Proc: too many args");
+            }
+
+            auto frame = lambda->derive_frame();
+            for (size_t slot = 0; slot < lambda->arity; ++slot) {
+                frame->set_slot(slot, execute(*codes[slot], env));
+            }
+            if (lambda->variadic) {
+                frame->set_slot(lambda->arity, values(lambda->arity, env));
+            }
+            return lambda->enter(std::move(frame), tail);
+        }
+
+        if (core->applicative()) {
+            return with_values(0, env, [&core, &env](Values values) { return core->apply_values(values, env); });
+        }
+
+        if (_special_proc.core() == core.get()) {
+            return run_special(env, tail);
+        }
+        auto code = core->analyze(form, scope);
+        auto const special = core->special_form();
+        if (code || special != SpecialForm::none) {
+            // the operator is another one than the site has seen, its binding
+            // having changed: the site keeps to the new one from now on
+            if (_running > 0) {
+                _retired.emplace_back(std::move(_special_proc), std::move(_special_code));
+            }
+            _special_proc = proc;
+            _special_code = std::move(code);
+            _special_form = special;
+            _by_name = name && special != SpecialForm::none && bound_special_form(*name) == special;
+            return run_special(env, tail);
+        }
+        return core->call_form(form, env, tail);
+    }
+
+    Node run_special(Env& env, TailCall& tail) const
+    {
+        struct Running {
+            explicit Running(CallCode const& c) : code{c}
+            {
+                ++code._running;
+            }
+            ~Running()
+            {
+                if (--code._running == 0) {
+                    code._retired.clear();
+                }
+            }
+            CallCode const& code;
+        } running{*this};
+
+        if (_special_code) {
+            return _special_code->run(env, tail);
+        }
+        return static_cast<Proc::Core*>(_special_proc.core())->call_form(form, env, tail);
+    }
+
+    void trace(ReferenceVisitor& visitor) const override
+    {
+        op->trace(visitor);
+        visitor.visit(form);
+        visitor.visit(_special_proc);
+        if (_special_code) {
+            _special_code->trace(visitor);
+        }
+        for (auto const& [proc, code] : _retired) {
+            visitor.visit(proc);
+            if (code) {
+                code->trace(visitor);
+            }
+        }
+        if (_arg_codes) {
+            for (auto const& code : *_arg_codes) {
+                code->trace(visitor);
+            }
+        }
+    }
+
+    Codes const& arg_codes() const
+    {
+        if (!_arg_codes) {
+            Codes codes;
+            for_each(args, [&codes, this](Node const& arg) { codes.push_back(analyze(arg, scope)); });
+            _arg_codes = std::move(codes);
+        }
+        return *_arg_codes;
+    }
+
+    // Calls `func` with the values of the arguments from `first` on
+    template <typename Func>
+    std::invoke_result_t<Func&, Values> with_values(size_t first, Env& env, Func&& func) const
+    {
+        auto const& codes = arg_codes();
+        auto const count = codes.size() - first;
+        if (count <= small_count) {
+            std::array<Node, small_count> values;
+            for (size_t i = 0; i < count; ++i) {
+                values[i] = execute(*codes[first + i], env);
+            }
+            return func(Values{values.data(), count});
+        }
+
+        std::vector<Node> values;
+        values.reserve(count);
+        for (auto i = first; i < codes.size(); ++i) {
+            values.push_back(execute(*codes[i], env));
+        }
+        return func(Values{values.data(), count});
+    }
+
+    // The values of the arguments from `first` on, as a list
+    List values(size_t first, Env& env) const
+    {
+        return with_values(first, env, [](Values values) { return to_list(values); });
+    }
+
+    static List to_list(Values values)
+    {
+        List list;
+        for (auto i = values.size(); i > 0; --i) {
+            list = cons(values[i - 1], list);
+        }
+        return list;
+    }
+
+    // argument counts whose values are gathered without allocating
+    static constexpr size_t small_count = 8;
+
+    std::unique_ptr<Code const> const op;
+    List const form; // (op arg...)
+    List const args;
+    std::shared_ptr<Scope const> const scope;
+
+    // the operator, if it is a name bound globally rather than as an argument
+    std::optional<Symbol> const name;
+
+private:
+    // analyzed on first use; the args of special forms never are
+    mutable std::optional<Codes> _arg_codes;
+
+    // the last proc that analyzed the call (see Proc::Core::analyze) or
+    // implements a special form, and the code it made, if any
+    mutable Node _special_proc;
+    mutable std::unique_ptr<Code const> _special_code;
+    mutable SpecialForm _special_form = SpecialForm::none;
+
+    // the ones replaced while a run of theirs was under way (e.g. a macro
+    // expansion calling the site again), kept until it is done
+    mutable unsigned _running = 0;
+    mutable std::vector<std::pair<Node, std::unique_ptr<Code const>>> _retired;
+
+    // whether `name` names the special form, so that `_special_proc` is called
+    // without evaluating the operator while bound_special_form says so
+    mutable bool _by_name = false;
+};
+
+} // namespace
+
+std::unique_ptr<Code const> analyze(Node const& expr, std::shared_ptr<Scope const> const& scope)
+{
+    if (auto list = List::from_node(expr); list && !list->empty()) {
+        auto name = Symbol::from_node(car(*list));
+        if (auto address = name && scope ? scope->resolve(*name) : nullptr) {
+            if (address->slot != Scope::Address::global) {
+                name.reset(); // a lambda argument
+            }
+        }
+        return std::make_unique<CallCode>(analyze(car(*list), scope), *list, scope, std::move(name));
+    }
+    if (auto sym = Symbol::from_node(expr)) {
+        auto address = scope ? scope->resolve(*sym) : nullptr;
+        return std::make_unique<SymbolCode>(*sym, address ? *address : Scope::Address{0, Scope::Address::global});
+    }
+    return make_constant(expr);
+}
+
+std::unique_ptr<Code const> make_constant(Node value)
+{
+    return std::make_unique<ConstantCode>(std::move(value));
+}
+
+} // namespace mll
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <mll/node.hpp>
+#include <mll/proc.hpp>
+
+#include <memory>
+
+namespace mll {
+
+class Env;
+class Scope;
+
+// Executable form of an expression, analyzed once in the style of SICP's
+// analyzing evaluator. Running it does not walk the raw expression again:
+// symbols are resolved to frame addresses up front, and calls to lambdas and
+// applicative procs evaluate their arguments through analyzed code. Lambda
+// bodies are analyzed when the lambda is made (see make_lambda).
+//
+// The arguments of a call are analyzed the first time they are evaluated, so
+// analyzed code is, like Env, not safe to run on several threads at once.
+class Code {
+public:
+    virtual ~Code() = default;
+
+    // Either returns the value, or fills in `tail` (see TailCall).
+    virtual Node run(Env&, TailCall& tail) const = 0;
+
+    // Reports the nodes the code keeps alive (see Node::Core::trace).
+    virtual void trace(ReferenceVisitor&) const
+    {}
+};
+
+// Analyzes `expr`, to be run in frames laid out by `scope`.
+std::unique_ptr<Code const> analyze(Node const& expr, std::shared_ptr<Scope const> const& scope);
+
+// Code that evaluates to `value`.
+std::unique_ptr<Code const> make_constant(Node value);
+
+// Runs `code` in `env`, along with the tail calls it leaves, to a value.
+Node execute(Code const& code, Env& env); // throws EvalError
+
+} // namespace mll
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <mll/list.hpp>
+#include <mll/proc.hpp>
+#include <mll/symbol.hpp>
+
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace mll {
+
+// How values of type T are passed between Lisp and the funcs bind() makes
+// procs of. Specializations provide
+//
+//     static constexpr char const* expected = "a number"; // for type errors
+//     static std::optional<T> from_node(Node const&);      // nullopt if not a T
+//     static Node to_node(T const&);                       // for results
+//
+// Embedders specialize it for their own types (see mlisp::Number).
+template <typename T>
+struct NodeConversion;
+
+template <>
+struct NodeConversion<Node> {
+    static constexpr char const* expected = "a node";
+    static std::optional<Node> from_node(Node const& node)
+    {
+        return node;
+    }
+    static Node to_node(Node const& node)
+    {
+        return node;
+    }
+};
+
+// Lists, symbols and procs convert to and from nodes as themselves.
+template <typename T>
+struct NodeSubtypeConversion {
+    static std::optional<T> from_node(Node const& node)
+    {
+        return T::from_node(node);
+    }
+    static Node to_node(T const& value)
+    {
+        return value;
+    }
+};
+
+template <>
+struct NodeConversion<List> : NodeSubtypeConversion<List> {
+    static constexpr char const* expected = "a list";
+};
+
+template <>
+struct NodeConversion<Symbol> : NodeSubtypeConversion<Symbol> {
+    static constexpr char const* expected = "a symbol";
+};
+
+template <>
+struct NodeConversion<Proc> : NodeSubtypeConversion<Proc> {
+    static constexpr char const* expected = "a proc";
+};
+
+template <typename Signature, typename Func>
+struct BoundCore;
+
+// Converts the values of the arguments to Args, left to right, calls `func`
+// with them and converts its result back.
+template <typename R, typename... Args, typename Func>
+struct BoundCore<R(Args...), Func> final : NativeCore {
+    BoundCore(std::string name, Func f) : NativeCore{std::move(name), sizeof...(Args)}, func{std::move(f)}
+    {}
+
+    Node apply_values(Values values, Env& /*env*/) override
+    {
+        if (values.size() != sizeof...(Args)) {
+            throw_argc();
+        }
+        return invoke_with(values, std::index_sequence_for<Args...>{});
+    }
+
+    template <std::size_t... I>
+    Node invoke_with([[maybe_unused]] Values values, std::index_sequence<I...>)
+    {
+        // braced, so that the arguments are converted in order
+        std::tuple<std::decay_t<Args>...> args{convert<std::decay_t<Args>>(values[I])...};
+        if constexpr (std::is_void_v<R>) {
+            std::apply(func, std::move(args));
+            return nil;
+        }
+        else {
+            return NodeConversion<std::decay_t<R>>::to_node(std::apply(func, std::move(args)));
+        }
+    }
+
+    template <typename T>
+    T convert(Node const& value) const
+    {
+        auto converted = NodeConversion<T>::from_node(value);
+        if (!converted) {
+            throw_type_error(value, NodeConversion<T>::expected);
+        }
+        return std::move(*converted);
+    }
+
+    Func func;
+};
+
+// Makes an applicative proc of `func`, called as a `Signature`: the values of
+// its arguments are checked and converted to the argument types, and the
+// result converted back, by NodeConversion. A void result is nil.
+//
+//     double distance(double x, double y);
+//     env.set("distance", bind<double(double, double)>("distance", distance));
+//
+// Free functions are called through a plain function pointer.
+template <typename Signature, typename Func>
+Proc bind(std::string name, Func func)
+{
+    return Proc{make_ref<BoundCore<Signature, Func>>(std::move(name), std::move(func))};
+}
+
+} // namespace mll
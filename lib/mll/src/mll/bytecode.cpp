@@ -0,0 +1,256 @@
+#include <mll/bytecode.hpp>
+
+#include <mll/env.hpp>
+#include <mll/lambda.hpp>
+#include <mll/proc.hpp>
+
+#include <cassert>
+
+namespace mll {
+
+namespace {
+
+class Compiler final {
+public:
+    Compiler(std::shared_ptr<Scope const> scope, Env const& env) : _scope{std::move(scope)}, _env{env}
+    {}
+
+    void compile(Node const& expr, bool tail)
+    {
+        if (auto list = List::from_node(expr); list && !list->empty()) {
+            compile_call(*list, tail);
+        }
+        else if (auto sym = Symbol::from_node(expr)) {
+            emit(Op::load, add_variable(*sym));
+        }
+        else {
+            emit(Op::constant, add_constant(expr));
+        }
+    }
+
+    void compile_body(List body)
+    {
+        if (body.empty()) {
+            emit(Op::constant, add_constant(nil));
+        }
+        for (; !body.empty(); body = cdr(body)) {
+            auto const last = cdr(body).empty();
+            compile(car(body), last);
+            if (!last) {
+                emit(Op::pop);
+            }
+        }
+    }
+
+    // Ends the chunk, returning the value of what was compiled.
+    std::shared_ptr<Chunk const> finish()
+    {
+        emit(Op::ret);
+        return std::make_shared<Chunk const>(std::move(_chunk));
+    }
+
+private:
+    void compile_call(List const& call, bool tail)
+    {
+        auto const op = car(call);
+        auto const args = cdr(call);
+        auto const site = static_cast<std::uint32_t>(_chunk.sites.size());
+        _chunk.sites.push_back(CallSite{call, 0, tail, SpecialForm::none, 0, {}, nullptr});
+
+        auto proc = special_form_proc(op);
+        if (proc && compiles_inline(proc->core()->special_form(), args)) {
+            // the operator is loaded by `special`, only if it has to be
+            _chunk.sites[site].form = proc->core()->special_form();
+            _chunk.sites[site].variable = add_variable(*Symbol::from_node(op));
+            emit(Op::special, site);
+            compile_special(proc->core()->special_form(), args, tail);
+        }
+        else {
+            compile(op, false);
+            emit(Op::enter, site);
+            std::uint32_t argc = 0;
+            for_each(args, [this, &argc](Node const& arg) {
+                compile(arg, false);
+                ++argc;
+            });
+            emit(tail ? Op::tail_call : Op::call, argc);
+        }
+        _chunk.sites[site].end = here();
+    }
+
+    // The proc `op` is bound to now, if it implements a special form.
+    std::optional<Proc> special_form_proc(Node const& op) const
+    {
+        auto sym = Symbol::from_node(op);
+        if (!sym) {
+            return std::nullopt;
+        }
+        if (auto address = _scope ? _scope->resolve(*sym) : nullptr) {
+            if (address->slot != Scope::Address::global) {
+                return std::nullopt; // a lambda argument
+            }
+        }
+        auto value = _env.lookup(*sym);
+        if (!value) {
+            return std::nullopt;
+        }
+        auto proc = Proc::from_node(*value);
+        if (!proc || proc->core()->special_form() == SpecialForm::none) {
+            return std::nullopt;
+        }
+        return proc;
+    }
+
+    // Malformed special forms are left to the proc, to fail when called.
+    static bool compiles_inline(SpecialForm form, List const& args)
+    {
+        switch (form) {
+        case SpecialForm::none:
+        case SpecialForm::define:
+        case SpecialForm::set:
+        case SpecialForm::macro:
+            break;
+        case SpecialForm::quote:
+            return true;
+        case SpecialForm::cond:
+            for (auto clauses = args; !clauses.empty(); clauses = cdr(clauses)) {
+                if (!List::from_node(car(clauses))) {
+                    return false;
+                }
+            }
+            return true;
+        case SpecialForm::lambda:
+            if (args.empty() || cdr(args).empty()) {
+                return false;
+            }
+            if (auto formal_args = List::from_node(car(args))) {
+                for (auto c = *formal_args; !c.empty(); c = cdr(c)) {
+                    auto sym = Symbol::from_node(car(c));
+                    if (!sym || (is_variadic_arg(*sym) && !cdr(c).empty())) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+
+    void compile_special(SpecialForm form, List const& args, bool tail)
+    {
+        switch (form) {
+        case SpecialForm::none:
+        case SpecialForm::define:
+        case SpecialForm::set:
+        case SpecialForm::macro:
+            assert(false);
+            break;
+        case SpecialForm::quote:
+            emit(Op::constant, add_constant(car(args)));
+            break;
+        case SpecialForm::cond: {
+            std::vector<std::uint32_t> exits;
+            for (auto clauses = args; !clauses.empty(); clauses = cdr(clauses)) {
+                auto clause = *List::from_node(car(clauses));
+                compile(car(clause), false);
+                auto const next = emit(Op::jump_if_false, 0);
+                compile(cadr(clause), tail);
+                exits.push_back(emit(Op::jump, 0));
+                patch(next);
+            }
+            emit(Op::constant, add_constant(nil));
+            for (auto exit : exits) {
+                patch(exit);
+            }
+            break;
+        }
+        case SpecialForm::lambda:
+            emit(Op::closure, static_cast<std::uint32_t>(_chunk.lambdas.size()));
+            _chunk.lambdas.push_back(Chunk::Lambda{*List::from_node(car(args)), cdr(args)});
+            break;
+        }
+    }
+
+    std::uint32_t add_constant(Node const& value)
+    {
+        _chunk.constants.push_back(value);
+        return static_cast<std::uint32_t>(_chunk.constants.size() - 1);
+    }
+
+    std::uint32_t add_variable(Symbol const& sym)
+    {
+        auto address = _scope ? _scope->resolve(sym) : nullptr;
+        _chunk.variables.push_back(
+            Chunk::Variable{sym, address ? *address : Scope::Address{0, Scope::Address::global}, {}});
+        return static_cast<std::uint32_t>(_chunk.variables.size() - 1);
+    }
+
+    void emit(Op op)
+    {
+        _chunk.code.push_back(static_cast<std::uint32_t>(op));
+    }
+
+    // Returns the offset of the operand, for patch().
+    std::uint32_t emit(Op op, std::uint32_t operand)
+    {
+        emit(op);
+        _chunk.code.push_back(operand);
+        return here() - 1;
+    }
+
+    // Points the jump whose operand is at `offset` here.
+    void patch(std::uint32_t offset)
+    {
+        _chunk.code[offset] = here();
+    }
+
+    std::uint32_t here() const
+    {
+        return static_cast<std::uint32_t>(_chunk.code.size());
+    }
+
+    std::shared_ptr<Scope const> const _scope;
+    Env const& _env;
+    Chunk _chunk;
+};
+
+} // namespace
+
+void Chunk::trace(ReferenceVisitor& visitor) const
+{
+    for (auto const& constant : constants) {
+        visitor.visit(constant);
+    }
+    for (auto const& site : sites) {
+        visitor.visit(site.call);
+        visitor.visit(site.tail_expr);
+        if (site.tail_chunk) {
+            site.tail_chunk->trace(visitor);
+        }
+    }
+    for (auto const& variable : variables) {
+        variable.cache.trace(visitor);
+    }
+    for (auto const& lambda : lambdas) {
+        visitor.visit(lambda.formal_args);
+        visitor.visit(lambda.body);
+    }
+}
+
+std::shared_ptr<Chunk const> compile(Node const& expr, std::shared_ptr<Scope const> const& scope, Env const& env)
+{
+    Compiler compiler{scope, env};
+    compiler.compile(expr, true);
+    return compiler.finish();
+}
+
+std::shared_ptr<Chunk const> compile_body(List const& body, std::shared_ptr<Scope const> const& scope,
+                                          Env const& outer_env)
+{
+    Compiler compiler{scope, outer_env};
+    compiler.compile_body(body);
+    return compiler.finish();
+}
+
+} // namespace mll
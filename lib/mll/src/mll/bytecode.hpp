@@ -0,0 +1,96 @@
+#pragma once
+
+#include <mll/env.hpp>
+#include <mll/list.hpp>
+#include <mll/node.hpp>
+#include <mll/proc.hpp>
+#include <mll/scope.hpp>
+#include <mll/symbol.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mll {
+
+struct Chunk;
+
+// Bytecode for the VM that eval() runs in EvalMode::bytecode. Each
+// instruction is an opcode followed by its operands, all 32-bit words; `k`
+// operands index the chunk's tables and `target` operands are code offsets.
+enum class Op : std::uint32_t {
+    constant,      // k: push constants[k]
+    load,          // k: push the value of variables[k]
+    pop,           // drop the value on top
+    enter,         // k: the operator of sites[k] is on top (see CallSite)
+    special,       // k: sites[k] calls a special form (see CallSite)
+    call,          // n: apply the operator under the top n values to them
+    tail_call,     // n: `call`, replacing the current frame
+    jump,          // target
+    jump_if_false, // target: pop, jump if nil
+    closure,       // k: push a lambda made from lambdas[k] in the current env
+    ret,           // pop, return to the caller
+};
+
+// A call whose operator is only known at run time. `enter` leaves the operator
+// to the instructions that follow, which evaluate the arguments and `call` it,
+// if it is a lambda or an applicative proc. Otherwise it calls the operator
+// with `call` unevaluated (see Proc::Core::call_form) and jumps to `end` with
+// the result.
+//
+// `special` is compiled for calls to special forms by name, with the call
+// compiled inline after it. It falls through to that code without looking the
+// operator up while bound_special_form says the name is bound to `form`, or
+// if the operator, variables[variable], implements `form`; otherwise it calls
+// the operator like `enter` does.
+struct CallSite {
+    List call; // (op arg...)
+    std::uint32_t end;
+    bool tail; // the result is the result of the frame
+
+    // `special` only
+    SpecialForm form;
+    std::uint32_t variable;
+
+    // The last expression a native operator left to evaluate (see TailCall),
+    // and its chunk, reused while the operator leaves the same cell; a macro
+    // leaves the same expansion every time, for one
+    mutable Node tail_expr;
+    mutable std::shared_ptr<Chunk const> tail_chunk;
+};
+
+struct Chunk {
+    struct Variable {
+        Symbol sym;
+        Scope::Address address;
+        mutable LookupCache cache; // for global lookups
+    };
+
+    struct Lambda {
+        List formal_args;
+        List body;
+    };
+
+    std::vector<std::uint32_t> code;
+    std::vector<Node> constants;
+    std::vector<Variable> variables;
+    std::vector<CallSite> sites;
+    std::vector<Lambda> lambdas;
+
+    // Reports the nodes the chunk keeps alive (see Node::Core::trace).
+    void trace(ReferenceVisitor&) const;
+};
+
+// Compiles `expr`, to be run in frames laid out by `scope` (null outside of
+// lambda bodies). Calls to special forms are compiled inline if their operator
+// is a name bound in `env` to the proc implementing the form.
+std::shared_ptr<Chunk const> compile(Node const& expr, std::shared_ptr<Scope const> const& scope, Env const& env);
+
+// Compiles a lambda body, run in frames derived from `outer_env`.
+std::shared_ptr<Chunk const> compile_body(List const& body, std::shared_ptr<Scope const> const& scope,
+                                          Env const& outer_env);
+
+// Runs `chunk` in `env` to a value.
+Node run(std::shared_ptr<Chunk const> chunk, Env& env); // throws EvalError
+
+} // namespace mll
@@ -1,21 +1,50 @@
 #include <mll/custom.hpp>
 
+#include <atomic>
+
 namespace mll {
 
+Custom::Core::Core(std::uint32_t id) : Node::Core{Type::custom}, type_id{id}
+{}
+
 void Custom::Core::accept(NodeVisitor& visitor)
 {
-    visitor.visit(Custom{std::static_pointer_cast<Core>(shared_from_this())});
+    visitor.visit(Custom{Ref<Core>{this}});
 }
 
-Custom::Custom(Custom const& other) : _core{other._core}
+Custom::Custom(Custom const& other) : _node{other._node}
 {}
 
-Custom::Custom(std::shared_ptr<Core> const& core) : _core{core}
+Custom::Custom(Ref<Core> core) : _node{Ref<Node::Core>{std::move(core)}}
 {}
 
-std::shared_ptr<Custom::Core> const& Custom::core() const
+Custom::Custom(Node const& node) : _node{node}
+{}
+
+Custom::Core* Custom::core() const
+{
+    return static_cast<Core*>(_node.core());
+}
+
+void Custom::print(std::ostream& ostream, PrintContext context) const
+{
+    if (auto type = _node.immediate_type()) {
+        static_cast<ImmediateType const*>(type)->print(ostream, context, _node.immediate_bits());
+    }
+    else {
+        core()->print(ostream, context);
+    }
+}
+
+std::uint32_t Custom::register_type()
+{
+    static std::atomic<std::uint32_t> next_id{0};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+Node const& Custom::node() const
 {
-    return _core;
+    return _node;
 }
 
-} // namespace mll
\ No newline at end of file
+} // namespace mll
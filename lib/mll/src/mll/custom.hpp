@@ -2,11 +2,12 @@
 
 #include <mll/node.hpp>
 
+#include <cstring>
 #include <ostream>
+#include <type_traits>
 
 namespace mll {
 
-class Parser;
 enum class PrintContext;
 
 class Custom {
@@ -14,24 +15,45 @@ public:
     Custom(Custom const&);
 
     struct Core : Node::Core {
+        explicit Core(std::uint32_t type_id);
         void accept(NodeVisitor&) final;
         virtual void print(std::ostream&, PrintContext) = 0;
+
+        std::uint32_t const type_id; // see register_type()
+    };
+    Core* core() const; // null for immediates
+
+    // Hands out a new id for each CustomType, stored in its cores so that
+    // from_node can check the type without RTTI.
+    static std::uint32_t register_type();
+
+    struct ImmediateType : Node::ImmediateType {
+        void (*print)(std::ostream&, PrintContext, std::uint64_t);
     };
-    std::shared_ptr<Core> const& core() const;
+
+    void print(std::ostream&, PrintContext) const;
 
 protected:
-    explicit Custom(std::shared_ptr<Core> const&);
+    explicit Custom(Ref<Core>);
+    explicit Custom(Node const&);
+
+    Node const& node() const;
 
 private:
-    friend class Parser;
-    std::shared_ptr<Core> _core;
+    friend class Node;
+    Node _node;
 };
 
+// Values of trivially copyable types that fit in 64 bits (numbers, for
+// instance) are stored as node immediates; anything else lives in a Core.
 template <typename ValueType, typename ValuePrinter>
 class CustomType final : public Custom {
 public:
+    static constexpr bool is_immediate =
+        std::is_trivially_copyable_v<ValueType> && sizeof(ValueType) <= sizeof(std::uint64_t);
+
     struct Core : Custom::Core {
-        explicit Core(ValueType v) : value{std::move(v)}
+        explicit Core(ValueType v) : Custom::Core{CustomType::type_id()}, value{std::move(v)}
         {}
         void print(std::ostream& ostream, PrintContext context) final
         {
@@ -40,7 +62,13 @@ public:
         ValueType const value;
     };
 
-    explicit CustomType(ValueType value) : Custom{std::make_shared<Core>(std::move(value))}
+    static inline Custom::ImmediateType const immediate_type{
+        {[](Node const& node, NodeVisitor& visitor) { visitor.visit(*CustomType::from_node(node)); }},
+        [](std::ostream& ostream, PrintContext context, std::uint64_t bits) {
+            ValuePrinter::print(ostream, context, CustomType::from_bits(bits));
+        }};
+
+    explicit CustomType(ValueType value) : Custom{make_node(std::move(value))}
     {}
 
     CustomType(CustomType const& other) : Custom{other}
@@ -48,20 +76,59 @@ public:
 
     static std::optional<CustomType> from_node(Node const& node)
     {
-        if (auto core = std::dynamic_pointer_cast<Core>(node.core())) {
-            return CustomType{core};
+        if constexpr (is_immediate) {
+            if (node.immediate_type() == &immediate_type) {
+                return CustomType{node};
+            }
+        }
+        else {
+            auto core = node.core();
+            if (core && core->type == Node::Core::Type::custom &&
+                static_cast<Custom::Core*>(core)->type_id == type_id()) {
+                return CustomType{node};
+            }
         }
         return std::nullopt;
     }
 
-    ValueType const& value() const
+    decltype(auto) value() const
     {
-        return std::static_pointer_cast<Core>(Custom::core())->value;
+        if constexpr (is_immediate) {
+            return from_bits(node().immediate_bits());
+        }
+        else {
+            return static_cast<ValueType const&>(static_cast<Core const&>(*node().core()).value);
+        }
     }
 
 private:
-    CustomType(std::shared_ptr<Core> const& core) : Custom{core}
+    explicit CustomType(Node const& node) : Custom{node}
     {}
+
+    static std::uint32_t type_id()
+    {
+        static std::uint32_t const id = register_type();
+        return id;
+    }
+
+    static ValueType from_bits(std::uint64_t bits)
+    {
+        ValueType value;
+        std::memcpy(&value, &bits, sizeof(ValueType));
+        return value;
+    }
+
+    static Node make_node(ValueType value)
+    {
+        if constexpr (is_immediate) {
+            std::uint64_t bits = 0;
+            std::memcpy(&bits, &value, sizeof(ValueType));
+            return Node{immediate_type, bits};
+        }
+        else {
+            return Node{make_ref<Core>(std::move(value))};
+        }
+    }
 };
 
-} // namespace mll
\ No newline at end of file
+} // namespace mll
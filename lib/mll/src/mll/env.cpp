@@ -1,66 +1,422 @@
 #include <mll/env.hpp>
 
+#include <mll/alloc.hpp>
+#include <mll/eval.hpp>
+#include <mll/gc.hpp>
+#include <mll/list.hpp>
 #include <mll/node.hpp>
+#include <mll/proc.hpp>
 #include <mll/quote.hpp>
+#include <mll/scope.hpp>
+#include <mll/symbol.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 
 namespace mll {
 
+namespace {
+std::atomic<std::uint64_t> binding_version{1};
+
+std::atomic<std::uint64_t> cache_hits{0};
+std::atomic<std::uint64_t> cache_misses{0};
+
+// Not an atomic increment, which would cost as much as the lookup it counts
+void count(std::atomic<std::uint64_t>& counter)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+} // namespace
+
+LookupCacheStats LookupCache::stats()
+{
+    return LookupCacheStats{cache_hits.load(std::memory_order_relaxed), cache_misses.load(std::memory_order_relaxed)};
+}
+
+void LookupCache::reset_stats()
+{
+    cache_hits.store(0, std::memory_order_relaxed);
+    cache_misses.store(0, std::memory_order_relaxed);
+}
+
+void LookupCache::trace(ReferenceVisitor& visitor) const
+{
+    visitor.visit(_env);
+    visitor.visit(_value);
+}
+
+Env::~Env()
+{
+    if (_capture && _capture->twin) {
+        _capture->twin->_capture->origin = nullptr;
+    }
+    if (!_scope) {
+        bump_version();
+    }
+    if (_gc_tracked) {
+        GarbageCollector::untrack(*this);
+    }
+}
+
 std::shared_ptr<Env> Env::create()
 {
-    struct Env_ : Env {};
-    auto env = std::make_shared<Env_>();
+    auto env = create_frame();
+    env->_global = true;
+    GarbageCollector::track(*env);
     load_quote_procs(*env);
     return env;
 }
 
+std::shared_ptr<Env const> Env::freeze()
+{
+    if (_base) {
+        throw EvalError("Only root envs can be frozen.");
+    }
+    _frozen = true;
+    return shared_from_this();
+}
+
+bool Env::frozen() const
+{
+    return _frozen;
+}
+
+std::shared_ptr<Env> Env::fork() const
+{
+    if (!_frozen) {
+        throw EvalError("Only frozen envs can be forked.");
+    }
+    // The fork's own bindings go in `_vars`: cells for every symbol interned
+    // so far would make its first define cost as much as copying the root.
+    auto forked = create_frame();
+    forked->_base = std::const_pointer_cast<Env>(shared_from_this());
+    forked->_fork = true;
+    GarbageCollector::track(*forked);
+    return forked;
+}
+
 std::shared_ptr<Env> Env::derive_new()
 {
-    auto derived = create();
+    // Derived frames only hold their own bindings; the builtins (quote procs
+    // included) are found through the base chain.
+    auto derived = create_frame();
     derived->_base = shared_from_this();
+    GarbageCollector::track(*derived); // kept whole by the closures made in it
     return derived;
 }
 
-void Env::set(std::string const& name, Node const& value)
+std::shared_ptr<Env> Env::derive_new(std::shared_ptr<Scope const> scope)
 {
-    _vars[name] = value;
+    // Not tracked by the garbage collector until a closure keeps it (see
+    // capture); most lambda frames are never kept.
+    auto derived = create_frame();
+    derived->_base = shared_from_this();
+    derived->_slots.resize(scope->size());
+    derived->_scope = std::move(scope);
+    return derived;
 }
 
-bool Env::deep_update(std::string const& name, Node const& value)
+std::shared_ptr<Env> Env::create_frame()
 {
-    for (auto env = this; env; env = env->_base.get()) {
-        if (auto it = env->_vars.find(name); it != env->_vars.end()) {
-            it->second = value;
+    struct Env_ : Env {};
+    return make_core<Env_>();
+}
+
+void Env::set(Symbol const& sym, Node const& value)
+{
+    if (_frozen) {
+        throw_frozen(sym);
+    }
+    note_binding(sym, value);
+    bump_version();
+    if (auto var = find_var(sym)) {
+        *var = value;
+        if (auto copy = twin() ? twin()->find_var(sym) : nullptr) {
+            *copy = value;
+        }
+    }
+    else if (_global) {
+        if (sym.id() >= _cells.size()) {
+            _cells.resize(sym.id() + 1);
+        }
+        _cells[sym.id()] = Cell{value, true};
+    }
+    else {
+        auto const id = sym.id();
+        auto it = std::lower_bound(_vars.begin(), _vars.end(), id,
+                                   [](auto const& var, std::uint32_t i) { return var.first < i; });
+        _vars.emplace(it, id, value);
+        if (auto twin = this->twin()) {
+            twin->set(sym, value); // closures made here may name it
+        }
+    }
+}
+
+bool Env::deep_update(Symbol const& sym, Node const& value)
+{
+    Env* below = nullptr;
+    for (auto env = this; env; below = env, env = env->_base.get()) {
+        if (env->_frozen && env->find_var(sym)) {
+            // Frames made on the frozen env itself, such as the calls of
+            // lambdas defined in it, have no fork to take the copy.
+            if (!below || !below->_fork) {
+                throw_frozen(sym);
+            }
+            below->set(sym, value); // the fork's own copy from now on
+            return true;
+        }
+        if (env->shallow_update(sym, value)) {
             return true;
         }
     }
     return false;
 }
 
-bool Env::shallow_update(std::string const& name, Node const& value)
+bool Env::shallow_update(Symbol const& sym, Node const& value)
 {
-    if (auto it = _vars.find(name); it != _vars.end()) {
-        it->second = value;
+    if (auto var = find_var(sym)) {
+        if (_frozen) {
+            throw_frozen(sym);
+        }
+        note_binding(sym, value);
+        bump_version();
+        *var = value;
+        if (auto copy = twin() ? twin()->find_var(sym) : nullptr) {
+            *copy = value;
+        }
+        else if (auto origin = _capture && !_capture->twin ? _capture->origin : nullptr) {
+            origin->shallow_update(sym, value);
+        }
         return true;
     }
     return false;
 }
 
-std::optional<Node> Env::deep_lookup(std::string const& name) const
+std::optional<Node> Env::deep_lookup(Symbol const& sym) const
 {
     for (auto env = this; env; env = env->_base.get()) {
-        if (auto it = env->_vars.find(name); it != env->_vars.end()) {
-            return it->second;
+        if (auto var = env->find_var(sym)) {
+            return *var;
         }
     }
     return std::nullopt;
 }
 
-std::optional<Node> Env::shallow_lookup(std::string const& name) const
+std::optional<Node> Env::shallow_lookup(Symbol const& sym) const
+{
+    if (auto var = find_var(sym)) {
+        return *var;
+    }
+    return std::nullopt;
+}
+
+void Env::set(std::string_view name, Node const& value)
+{
+    set(Symbol{name}, value);
+}
+
+bool Env::deep_update(std::string_view name, Node const& value)
+{
+    auto sym = Symbol::find(name);
+    return sym && deep_update(*sym, value);
+}
+
+bool Env::shallow_update(std::string_view name, Node const& value)
+{
+    auto sym = Symbol::find(name);
+    return sym && shallow_update(*sym, value);
+}
+
+std::optional<Node> Env::deep_lookup(std::string_view name) const
+{
+    if (auto sym = Symbol::find(name)) {
+        return deep_lookup(*sym);
+    }
+    return std::nullopt;
+}
+
+std::optional<Node> Env::shallow_lookup(std::string_view name) const
 {
-    if (auto it = _vars.find(name); it != _vars.end()) {
-        return it->second;
+    if (auto sym = Symbol::find(name)) {
+        return shallow_lookup(*sym);
     }
     return std::nullopt;
 }
 
-} // namespace mll
\ No newline at end of file
+std::optional<Node> Env::lookup(Symbol const& sym) const
+{
+    auto const address = _scope ? _scope->resolve(sym) : nullptr;
+    if (!address) {
+        return deep_lookup(sym);
+    }
+    return lookup(sym, *address);
+}
+
+std::optional<Node> Env::lookup(Symbol const& sym, Scope::Address const& address) const
+{
+    Node const* shadowing = nullptr;
+    auto const env = frame_up(sym, address.depth, shadowing);
+    if (shadowing) {
+        return *shadowing;
+    }
+    if (address.slot == Scope::Address::global) {
+        return env->deep_lookup(sym);
+    }
+    return env->_slots[address.slot];
+}
+
+std::optional<Node> Env::lookup(Symbol const& sym, Scope::Address const& address, LookupCache& cache) const
+{
+    Node const* shadowing = nullptr;
+    auto const env = frame_up(sym, address.depth, shadowing);
+    if (shadowing) {
+        return *shadowing;
+    }
+    if (address.slot != Scope::Address::global) {
+        return env->_slots[address.slot];
+    }
+    if (env->_scope) {
+        return env->deep_lookup(sym);
+    }
+
+    auto const current = version();
+    if (cache._version == current && cache._env.get() == env) {
+        count(cache_hits);
+        return cache._value;
+    }
+    count(cache_misses);
+    auto value = env->deep_lookup(sym);
+    if (value) {
+        cache._version = current;
+        cache._env = std::const_pointer_cast<Env>(env->shared_from_this());
+        cache._value = *value;
+    }
+    return value;
+}
+
+std::uint64_t Env::version()
+{
+    return binding_version.load(std::memory_order_relaxed);
+}
+
+void Env::throw_frozen(Symbol const& sym)
+{
+    throw EvalError("Cannot bind " + sym.name() + " in a frozen env.");
+}
+
+void Env::bump_version()
+{
+    binding_version.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Env::set_slot(size_t slot, Node const& value)
+{
+    _slots[slot] = value;
+}
+
+std::shared_ptr<Env> Env::capture(std::vector<Symbol> const& syms)
+{
+    if (!_scope) {
+        return shared_from_this();
+    }
+    auto base = _base->capture(syms);
+    if (_capture && !_capture->twin) { // a twin already
+        if (_capture->origin) {
+            extend(syms, *_capture->origin);
+        }
+        return shared_from_this();
+    }
+    if (!_capture) {
+        static auto const no_slots = std::make_shared<Scope const>(std::vector<Symbol>{}, List{}, *this);
+        auto twin = create_frame();
+        twin->_base = std::move(base);
+        twin->_scope = no_slots;
+        GarbageCollector::track(*twin);
+        twin->_capture = std::make_unique<Capture>(Capture{nullptr, this});
+        _capture = std::make_unique<Capture>(Capture{std::move(twin), nullptr});
+    }
+    _capture->twin->extend(syms, *this);
+    return _capture->twin;
+}
+
+std::shared_ptr<Env> Env::capture()
+{
+    GarbageCollector::track(*this); // unless it is already
+    return shared_from_this();
+}
+
+Env* Env::twin() const
+{
+    return _capture ? _capture->twin.get() : nullptr;
+}
+
+void Env::extend(std::vector<Symbol> const& syms, Env const& origin)
+{
+    std::vector<Symbol> names;
+    for (auto const& sym : syms) {
+        if (find_var(sym)) {
+            continue;
+        }
+        if (auto var = origin.find_var(sym)) {
+            if (names.empty()) {
+                for (size_t slot = 0; slot < _scope->size(); ++slot) {
+                    names.push_back(_scope->slot_name(slot));
+                }
+            }
+            names.push_back(sym);
+            _slots.push_back(*var);
+        }
+    }
+    // Closures resolved against the old scope read the slots they knew, which
+    // stay where they were.
+    if (!names.empty()) {
+        _scope = std::make_shared<Scope const>(std::move(names), List{}, *_base);
+    }
+}
+
+Node* Env::find_var(Symbol const& sym)
+{
+    return const_cast<Node*>(static_cast<Env const*>(this)->find_var(sym));
+}
+
+Node const* Env::find_var(Symbol const& sym) const
+{
+    if (_global) {
+        auto const id = sym.id();
+        return id < _cells.size() && _cells[id].bound ? &_cells[id].value : nullptr;
+    }
+    if (_scope) {
+        if (auto slot = _scope->find_slot(sym)) {
+            return &_slots[*slot];
+        }
+    }
+    return find_in_vars(sym.id());
+}
+
+Node const* Env::find_in_vars(std::uint32_t id) const
+{
+    auto it = std::lower_bound(_vars.begin(), _vars.end(), id,
+                               [](auto const& var, std::uint32_t i) { return var.first < i; });
+    return it != _vars.end() && it->first == id ? &it->second : nullptr;
+}
+
+Env const* Env::frame_up(Symbol const& sym, size_t depth, Node const*& shadowing) const
+{
+    // Frames on the way may have grown bindings via `define` after the scope
+    // was resolved; those shadow the resolved address.
+    auto env = this;
+    for (size_t i = 0; i < depth; ++i) {
+        if (!env->_vars.empty()) {
+            if (auto var = env->find_in_vars(sym.id())) {
+                shadowing = var;
+                return env;
+            }
+        }
+        env = env->_base.get();
+        assert(env);
+    }
+    return env;
+}
+
+} // namespace mll
@@ -1,29 +1,166 @@
 #pragma once
 
-#include <map>
+#include <mll/node.hpp>
+#include <mll/scope.hpp>
+
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace mll {
 
-class Node;
+class Scope;
+class Symbol;
+
+struct LookupCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0; // including the first lookup at each site
+};
+
+// What a global lookup (see Env::lookup) found at one site in analyzed code or
+// bytecode: the env it started from and the value. It holds while the binding
+// version (see Env::version) stays the same, so hits skip the walk up the base
+// chain. Frames with slots are never cached, as their slots change unseen.
+class LookupCache final {
+public:
+    // Process-wide counts, kept without atomic increments: approximate when
+    // several threads evaluate at once.
+    static LookupCacheStats stats();
+    static void reset_stats();
+
+    // Reports the env and the value held (see Node::Core::trace).
+    void trace(ReferenceVisitor&) const;
+
+private:
+    friend class Env;
+    std::uint64_t _version = 0; // versions start at 1
+    std::shared_ptr<Env> _env;
+    Node _value;
+};
 
 class Env : public std::enable_shared_from_this<Env> {
 public:
+    ~Env();
+
     static std::shared_ptr<Env> create();
     std::shared_ptr<Env> derive_new();
+    std::shared_ptr<Env> derive_new(std::shared_ptr<Scope const>);
+
+    // Makes this root env immutable, to be shared as the base of forks, by
+    // several threads if the values bound in it can be. Setting or updating
+    // its bindings then raises EvalError, as does freezing a derived env.
+    std::shared_ptr<Env const> freeze(); // throws EvalError
+    bool frozen() const;
+
+    // A new env for one evaluation context on top of this frozen one, made in
+    // O(1). It takes its own bindings, and updates of the frozen bindings are
+    // copied into it rather than written through. Updates from frames that do
+    // not go through a fork, such as the calls of lambdas defined in the frozen
+    // env, raise EvalError, as does forking an env that is not frozen.
+    std::shared_ptr<Env> fork() const; // throws EvalError
+
+    void set(Symbol const&, Node const&);
+    bool deep_update(Symbol const&, Node const&);
+    bool shallow_update(Symbol const&, Node const&);
+    std::optional<Node> deep_lookup(Symbol const&) const;
+    std::optional<Node> shallow_lookup(Symbol const&) const;
+
+    // Name based variants; names that were never interned are never bound.
+    void set(std::string_view, Node const&);
+    bool deep_update(std::string_view, Node const&);
+    bool shallow_update(std::string_view, Node const&);
+    std::optional<Node> deep_lookup(std::string_view) const;
+    std::optional<Node> shallow_lookup(std::string_view) const;
 
-    void set(std::string const&, Node const&);
-    bool deep_update(std::string const&, Node const&);
-    bool shallow_update(std::string const&, Node const&);
-    std::optional<Node> deep_lookup(std::string const&) const;
-    std::optional<Node> shallow_lookup(std::string const&) const;
+    // Lookup through the lexical address resolved by the frame's scope; falls
+    // back to `deep_lookup` for symbols the scope does not know about. The
+    // second form takes the address resolved beforehand. A global read still
+    // walks the frames up to the root, checking those with bindings of their
+    // own for one that shadows it; only the third form, with a LookupCache
+    // hit, skips the lookup in the root's cells.
+    std::optional<Node> lookup(Symbol const&) const;
+    std::optional<Node> lookup(Symbol const&, Scope::Address const&) const;
+    std::optional<Node> lookup(Symbol const&, Scope::Address const&, LookupCache&) const;
+
+    // Bumped by every change to a binding, in any env, and whenever an env
+    // without slots goes away, so that its address may be reused.
+    static std::uint64_t version();
+
+    // Sets a slot of a frame being bound, before anything runs in it.
+    void set_slot(size_t slot, Node const&);
+
+    // What a closure made in this env keeps in its place (see make_lambda).
+    // For a frame with slots, that is its twin: a frame that holds copies of
+    // just the bindings of `syms` found in it, and of the ones defined in it
+    // later, on top of the twins of the slot frames above. All the closures
+    // made in a frame share its twin, which is kept in step with the frame
+    // both ways while the frame lives, so that they and the frame see each
+    // other's updates. Other envs are kept whole.
+    std::shared_ptr<Env> capture(std::vector<Symbol> const& syms);
+
+    // The whole env, for closures that may name any of its bindings.
+    std::shared_ptr<Env> capture();
 
 private:
     Env() = default;
+    static std::shared_ptr<Env> create_frame();
+
+    Node* find_var(Symbol const&);
+    Node const* find_var(Symbol const&) const;
+    Node const* find_in_vars(std::uint32_t id) const;
+
+    // The frame `depth` frames up, unless a frame on the way grew a binding of
+    // `sym` (via `define`) that shadows it, which is then left in `shadowing`.
+    Env const* frame_up(Symbol const& sym, size_t depth, Node const*& shadowing) const;
+
+    static void bump_version();
+    [[noreturn]] static void throw_frozen(Symbol const&);
+
+    // Copies into this twin the bindings of `syms` in `origin` it lacks.
+    void extend(std::vector<Symbol> const& syms, Env const& origin);
+
+    // The twin of this frame, once closures were made in it
+    Env* twin() const;
+
+    friend class Scope;
+    friend class GarbageCollector;
+    friend class HeapGraph;
     std::shared_ptr<Env> _base;
-    std::map<std::string, Node> _vars;
+    std::shared_ptr<Scope const> _scope;
+    std::vector<Node> _slots;
+    // Bindings other than slots, sorted by symbol id. Frames rarely have more
+    // than a few, which a flat vector searches fastest.
+    std::vector<std::pair<std::uint32_t, Node>> _vars;
+
+    bool _frozen = false;
+    bool _fork = false; // made by fork(), to take copies of frozen bindings
+
+    // Root envs keep their bindings in cells indexed by symbol id instead of
+    // `_vars`, so that a global is found in one load. Forks, many of which may
+    // share a root, keep theirs in `_vars`.
+    bool _global = false;
+    struct Cell {
+        Node value;
+        bool bound = false;
+    };
+    std::vector<Cell> _cells;
+
+    // The twin of a frame closures were made in (see capture), or on a twin,
+    // the frame it copies, until that goes away
+    struct Capture {
+        std::shared_ptr<Env> twin;
+        Env* origin = nullptr;
+    };
+    std::unique_ptr<Capture> _capture;
+
+    // intrusive list of envs tracked by the garbage collector
+    bool _gc_tracked = false;
+    Env* _gc_prev = nullptr;
+    Env* _gc_next = nullptr;
 };
 
-} // namespace mll
\ No newline at end of file
+} // namespace mll
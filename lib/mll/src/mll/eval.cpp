@@ -1,71 +1,483 @@
 #include <mll/eval.hpp>
 
+#include <mll/analyze.hpp>
+#include <mll/bytecode.hpp>
 #include <mll/env.hpp>
+#include <mll/lambda.hpp>
 #include <mll/list.hpp>
 #include <mll/print.hpp>
 #include <mll/proc.hpp>
 #include <mll/symbol.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
 
 namespace mll {
 
 namespace {
-class Evaluator : NodeVisitor {
-public:
-    explicit Evaluator(Env& env) : _env{env}
-    {}
 
-    Node evaluate(Node const& expr)
+std::atomic<EvalMode> mode{EvalMode::recursive};
+std::atomic<std::size_t> max_depth{10'000};
+
+// nested eval() calls on this thread
+thread_local std::size_t depth = 0;
+
+[[noreturn]] void throw_too_deep()
+{
+    throw EvalError("Maximum evaluation depth (" + std::to_string(max_depth.load(std::memory_order_relaxed)) +
+                    ") exceeded.");
+}
+
+// The lowest address this thread's native stack may grow down to before
+// evaluation stops, or 0 where its bounds are not known. What is left below
+// it is for the native code that runs between two guards.
+std::uintptr_t find_native_stack_limit()
+{
+    std::uintptr_t low = 0;
+    std::size_t size = 0;
+#if defined(__linux__)
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        void* addr = nullptr;
+        if (pthread_attr_getstack(&attr, &addr, &size) == 0) {
+            low = reinterpret_cast<std::uintptr_t>(addr);
+        }
+        pthread_attr_destroy(&attr);
+    }
+#elif defined(__APPLE__)
+    size = pthread_get_stacksize_np(pthread_self());
+    low = reinterpret_cast<std::uintptr_t>(pthread_get_stackaddr_np(pthread_self())) - size;
+#elif defined(_WIN32)
+    ULONG_PTR lowest = 0;
+    ULONG_PTR highest = 0;
+    GetCurrentThreadStackLimits(&lowest, &highest);
+    low = lowest;
+    size = highest - lowest;
+#endif
+    if (low == 0) {
+        return 0;
+    }
+    return low + std::min(size / 4, std::size_t{256 * 1024});
+}
+
+thread_local std::uintptr_t const native_stack_limit = find_native_stack_limit();
+
+[[noreturn]] void throw_out_of_stack()
+{
+    throw EvalError("Evaluation too deep for the native stack.");
+}
+
+// Counts a nested evaluation against the depth limit, and checks that the
+// native stack has room for it: how much each level takes depends on the
+// code and on how it was compiled, so the depth limit alone may not hold.
+class DepthGuard final {
+public:
+    DepthGuard()
     {
-        expr.accept(*this);
-        return _result;
+        if (++depth > max_depth.load(std::memory_order_relaxed)) {
+            --depth;
+            throw_too_deep();
+        }
+        char here;
+        if (reinterpret_cast<std::uintptr_t>(&here) < native_stack_limit) {
+            --depth;
+            throw_out_of_stack();
+        }
     }
 
-private:
-    void visit(List const& list) override
+    ~DepthGuard()
     {
-        if (list.empty()) {
-            _result = nil;
-            return;
+        --depth;
+    }
+
+    DepthGuard(DepthGuard const&) = delete;
+    DepthGuard& operator=(DepthGuard const&) = delete;
+};
+
+Proc to_proc_or_throw(Node const& node)
+{
+    if (auto proc = dynamic_node_cast<Proc>(node)) {
+        return *proc;
+    }
+    throw EvalError(std::to_string(node) + " is not a proc.");
+}
+
+Node eval_symbol(Symbol const& sym, Env& env)
+{
+    auto value = env.lookup(sym);
+    if (!value.has_value()) {
+        throw EvalError("Unknown symbol: " + sym.name());
+    }
+    return *value;
+}
+
+// Evaluates `expr` one step: either returns the value, or fills in `tail`
+// (see TailCall). Dispatches on the core's type tag (or the immediate's type)
+// rather than through NodeVisitor, saving a virtual call and a temporary per
+// evaluation.
+Node eval_step(Node const& expr, Env& env, TailCall& tail)
+{
+    if (auto core = expr.core()) {
+        switch (core->type) {
+        case Node::Core::Type::list: {
+            auto const& list = static_cast<List::Core const&>(*core);
+            auto proc = to_proc_or_throw(eval(list.head, env));
+            return proc.core()->call_form(*List::from_node(expr), env, tail);
+        }
+        case Node::Core::Type::proc:
+            assert(false);
+            break;
+        case Node::Core::Type::custom:
+            break;
         }
+        return expr;
+    }
+
+    if (auto sym = Symbol::from_node(expr)) {
+        return eval_symbol(*sym, env);
+    }
+    return expr; // nil and custom immediates evaluate to themselves
+}
 
-        auto node = eval(car(list), _env);
-        if (auto proc = dynamic_node_cast<Proc>(node)) {
-            _result = proc->call(cdr(list), _env);
+// Evaluates tail calls left by procs, and the ones they leave in turn, in a
+// loop.
+Node run_tail_calls(TailCall tail)
+{
+    for (;;) {
+        TailCall next;
+        auto result = tail.code ? tail.code->run(*tail.env, next) : eval_step(tail.expr, *tail.env, next);
+        if (!next.env) {
+            return result;
         }
-        else {
-            throw EvalError(std::to_string(node) + " is not a proc.");
+        tail = std::move(next);
+    }
+}
+
+// CEK-style evaluator: the control is the expression being evaluated and its
+// env, or a value; the continuation is a stack of frames that says what to do
+// with the value. Frames are shared by all the machines nested on a thread.
+// The arguments of lambdas and applicative procs are evaluated in frames; only
+// procs that evaluate their own arguments are called on the native stack.
+class Machine final {
+public:
+    static Node run(Node const& expr, Env& env)
+    {
+        return Machine{}.evaluate(expr, env.shared_from_this());
+    }
+
+private:
+    struct Frame {
+        enum class Kind {
+            apply,  // evaluating the operator of the call `exprs`
+            arg,    // evaluating the arguments in `exprs` for `lambda`
+            values, // evaluating the arguments in `exprs` for an applicative `callee`
+            body,   // evaluating a lambda body; `exprs` are the ones left
+        };
+
+        Kind kind;
+        std::shared_ptr<Env> env; // where `exprs` are evaluated
+        List exprs;
+
+        // arg and values frames only
+        Node callee; // keeps `lambda` alive
+        std::vector<Node> rest; // values for the variadic argument, or all of them
+
+        // arg frames only
+        LambdaCore const* lambda = nullptr;
+        std::shared_ptr<Env> lambda_env;
+        List formal_args; // those not bound yet
+        std::size_t slot = 0;
+        bool variadic = false;
+    };
+
+    Machine() : _base{frames().size()}
+    {}
+
+    ~Machine()
+    {
+        // unwinding from an error leaves frames behind
+        frames().resize(_base);
+    }
+
+    Machine(Machine const&) = delete;
+    Machine& operator=(Machine const&) = delete;
+
+    static std::vector<Frame>& frames()
+    {
+        thread_local std::vector<Frame> frames;
+        return frames;
+    }
+
+    static Frame& push(Frame::Kind kind, std::shared_ptr<Env> env, List exprs)
+    {
+        auto& stack = frames();
+        if (depth + stack.size() >= max_depth.load(std::memory_order_relaxed)) {
+            throw_too_deep();
         }
+        auto& frame = stack.emplace_back();
+        frame.kind = kind;
+        frame.env = std::move(env);
+        frame.exprs = std::move(exprs);
+        return frame;
     }
 
-    void visit(Proc const& /*proc*/) override
+    static void pop()
     {
-        assert(false);
+        frames().pop_back();
     }
 
-    void visit(Custom const& custom) override
+    Node evaluate(Node expr, std::shared_ptr<Env> env)
     {
-        _result = custom;
+        DepthGuard guard;
+        auto& stack = frames();
+
+        for (;;) {
+            // evaluate `expr` in `env`, until it has a value or needs a frame
+            Node value;
+            if (auto core = expr.core(); core && core->type == Node::Core::Type::list) {
+                push(Frame::Kind::apply, env, *List::from_node(expr));
+                expr = static_cast<List::Core const&>(*core).head;
+                continue;
+            }
+            else if (auto sym = Symbol::from_node(expr)) {
+                value = eval_symbol(*sym, *env);
+            }
+            else {
+                value = expr;
+            }
+
+            // hand the value to the frames, until one has an expression to
+            // evaluate
+            for (;;) {
+                if (stack.size() == _base) {
+                    return value;
+                }
+                auto& frame = stack.back();
+                if (frame.kind == Frame::Kind::apply) {
+                    auto proc = to_proc_or_throw(value);
+                    if (auto lambda = proc.core()->lambda()) {
+                        frame.kind = Frame::Kind::arg;
+                        frame.exprs = cdr(frame.exprs);
+                        frame.callee = std::move(value);
+                        frame.lambda = lambda;
+                        frame.lambda_env = lambda->derive_frame();
+                        frame.formal_args = lambda->formal_args;
+                    }
+                    else if (proc.core()->applicative()) {
+                        // its arguments are evaluated here, not on the native stack
+                        frame.kind = Frame::Kind::values;
+                        frame.exprs = cdr(frame.exprs);
+                        frame.callee = std::move(value);
+                    }
+                    else {
+                        auto form = std::move(frame.exprs);
+                        auto caller_env = std::move(frame.env);
+                        pop();
+                        TailCall tail;
+                        value = proc.core()->call_form(form, *caller_env, tail);
+                        if (tail.code) { // analyzed code runs on the native stack
+                            value = execute(*tail.code, *tail.env);
+                        }
+                        else if (tail.env) {
+                            expr = std::move(tail.expr);
+                            env = std::move(tail.env);
+                            break;
+                        }
+                        continue;
+                    }
+                }
+                else if (frame.kind == Frame::Kind::arg) {
+                    if (frame.variadic) {
+                        frame.rest.push_back(std::move(value));
+                    }
+                    else {
+                        frame.lambda_env->set_slot(frame.slot++, value);
+                        frame.formal_args = cdr(frame.formal_args);
+                    }
+                    frame.exprs = cdr(frame.exprs);
+                }
+                else if (frame.kind == Frame::Kind::values) {
+                    frame.rest.push_back(std::move(value));
+                    frame.exprs = cdr(frame.exprs);
+                }
+                else {
+                    // a body expression other than the last one
+                    expr = car(frame.exprs);
+                    env = frame.env;
+                    frame.exprs = cdr(frame.exprs);
+                    if (frame.exprs.empty()) {
+                        pop(); // `expr` is a tail call
+                    }
+                    break;
+                }
+
+                // values frame: evaluate the next argument, or apply the callee
+                if (frame.kind == Frame::Kind::values) {
+                    if (!frame.exprs.empty()) {
+                        expr = car(frame.exprs);
+                        env = frame.env;
+                        break;
+                    }
+                    // moved off the frame first, since the call may grow the stack
+                    auto callee = *Proc::from_node(frame.callee);
+                    auto values = std::move(frame.rest);
+                    auto caller_env = std::move(frame.env);
+                    pop();
+                    value = callee.core()->apply_values(Values{values.data(), values.size()}, *caller_env);
+                    continue;
+                }
+
+                // arg frame: evaluate the next argument, or enter the body
+                if (next_arg(frame)) {
+                    expr = car(frame.exprs);
+                    env = frame.env;
+                    break;
+                }
+                auto body = frame.lambda->body;
+                auto lambda_env = std::move(frame.lambda_env);
+                pop();
+                if (body.empty()) {
+                    value = nil;
+                    continue;
+                }
+                expr = car(body);
+                env = lambda_env;
+                if (!cdr(body).empty()) {
+                    push(Frame::Kind::body, std::move(lambda_env), cdr(body));
+                }
+                break;
+            }
+        }
     }
 
-    void visit(Symbol const& sym) override
+    // Returns whether an argument is left to evaluate; binds the variadic
+    // argument and checks the argument count otherwise.
+    static bool next_arg(Frame& frame)
     {
-        auto value = _env.deep_lookup(sym.name());
-        if (!value.has_value()) {
-            throw EvalError("Unknown symbol: " + sym.name());
+        if (!frame.variadic && !frame.formal_args.empty()) {
+            auto sym = dynamic_node_cast<Symbol>(car(frame.formal_args));
+            assert(sym.has_value());
+            frame.variadic = is_variadic_arg(*sym);
+        }
+
+        if (frame.variadic) {
+            if (!frame.exprs.empty()) {
+                return true;
+            }
+            List rest;
+            for (auto it = frame.rest.rbegin(); it != frame.rest.rend(); ++it) {
+                rest = cons(*it, rest);
+            }
+            frame.lambda_env->set_slot(frame.slot, rest);
+            return false;
+        }
+
+        if (frame.formal_args.empty()) {
+            if (!frame.exprs.empty()) {
+                throw EvalError("Proc: too many args");
+            }
+            return false;
         }
-        _result = *value;
+
+        if (frame.exprs.empty()) {
+            throw EvalError("Proc: too few args");
+        }
+        return true;
     }
 
-private:
-    Env& _env;
-    Node _result;
+    std::size_t const _base;
 };
+
 } // namespace
 
 Node eval(Node const& expr, Env& env)
 {
-    return Evaluator{env}.evaluate(expr);
+    auto const m = mode.load(std::memory_order_relaxed);
+    if (m == EvalMode::stack) {
+        return Machine::run(expr, env);
+    }
+    DepthGuard guard;
+    if (m == EvalMode::bytecode) {
+        // only calls are worth compiling
+        if (auto list = List::from_node(expr); list && !list->empty()) {
+            return run(compile(expr, nullptr, env), env);
+        }
+    }
+    TailCall tail;
+    auto result = eval_step(expr, env, tail);
+    return tail.env ? run_tail_calls(std::move(tail)) : result;
+}
+
+Node apply(Proc const& proc, Values values, Env& env)
+{
+    auto const& core = proc.core();
+    auto lambda = core->lambda();
+    if (!lambda) {
+        if (!core->applicative()) {
+            throw EvalError(core->name + " is not applicable to values.");
+        }
+        return core->apply_values(values, env);
+    }
+
+    auto frame = lambda->bind(values);
+    auto const m = mode.load(std::memory_order_relaxed);
+    if (m == EvalMode::bytecode) {
+        return run(lambda->chunk(), *frame);
+    }
+    if (m == EvalMode::stack) {
+        // the body expressions, as the machine would evaluate them
+        Node result;
+        for_each(lambda->body, [&result, &frame](Node const& expr) { result = Machine::run(expr, *frame); });
+        return result;
+    }
+    DepthGuard guard;
+    TailCall tail;
+    auto result = lambda->enter(std::move(frame), tail);
+    return tail.env ? run_tail_calls(std::move(tail)) : result;
+}
+
+Node execute(Code const& code, Env& env)
+{
+    // Analyzed code nests only as deep as the expression it came from, except
+    // through tail calls, which is where lambda bodies are run; those are
+    // counted against the depth limit.
+    TailCall tail;
+    auto result = code.run(env, tail);
+    if (!tail.env) {
+        return result;
+    }
+    DepthGuard guard;
+    return run_tail_calls(std::move(tail));
+}
+
+void set_eval_mode(EvalMode m)
+{
+    mode.store(m, std::memory_order_relaxed);
 }
-} // namespace mll
\ No newline at end of file
+
+EvalMode eval_mode()
+{
+    return mode.load(std::memory_order_relaxed);
+}
+
+void set_max_eval_depth(std::size_t d)
+{
+    max_depth.store(d, std::memory_order_relaxed);
+}
+
+std::size_t max_eval_depth()
+{
+    return max_depth.load(std::memory_order_relaxed);
+}
+
+} // namespace mll
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cstddef>
 #include <stdexcept>
 
 namespace mll {
 
 class Env;
 class Node;
+class Proc;
+class Values;
 
 class EvalError : public std::runtime_error {
 public:
@@ -14,4 +17,39 @@ public:
 
 Node eval(Node const& expr, Env& env); // throws EvalError
 
-} // namespace mll
\ No newline at end of file
+// Calls `proc` with `values` as the values of its arguments, which are not
+// evaluated again: a lambda's frame is bound to them as they are, and
+// applicative procs get them through apply_values(). This is how the host
+// calls back into Lisp. Procs that take their arguments unevaluated raise
+// EvalError. `env` is the env of the call, for procs that use it.
+Node apply(Proc const& proc, Values values, Env& env); // throws EvalError
+
+// How eval() evaluates expressions, process-wide.
+//
+// `recursive` evaluates on the native stack. `stack` keeps its continuation
+// frames in a growable, heap-allocated stack instead: applying a lambda
+// (evaluating the operator and the arguments, binding them and evaluating the
+// body) then takes no native stack, nor does evaluating the arguments of an
+// applicative proc. Procs that take their arguments unevaluated, such as
+// macros, still evaluate them through a nested eval().
+//
+// `bytecode` compiles expressions to bytecode and runs them in a VM (see
+// bytecode.hpp). Lambdas called from bytecode run in the VM's own frames, and
+// the VM evaluates the arguments of applicative procs; procs that take their
+// arguments unevaluated evaluate them through a nested eval(), as in `stack`
+// mode.
+enum class EvalMode { recursive, stack, bytecode };
+
+void set_eval_mode(EvalMode);
+EvalMode eval_mode();
+
+// Evaluations nested deeper than this raise EvalError rather than exhaust the
+// stack. The depth counts nested eval() calls plus, in `stack` mode, pending
+// continuation frames. In `bytecode` mode, VM frames are limited separately.
+// Nested evaluations that would leave too little of the thread's native stack
+// raise EvalError as well, whatever the limit, where the stack's bounds are
+// known (on Linux, macOS and Windows).
+void set_max_eval_depth(std::size_t);
+std::size_t max_eval_depth();
+
+} // namespace mll
@@ -0,0 +1,271 @@
+#include <mll/gc.hpp>
+
+#include <mll/env.hpp>
+#include <mll/list.hpp>
+#include <mll/node.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace mll {
+
+namespace {
+
+constexpr std::size_t min_collect_threshold = 1024;
+
+struct Registry {
+    std::atomic<bool> enabled{false};
+
+    std::mutex mutex; // guards everything below
+    Env* head = nullptr;
+    std::size_t count = 0;
+    std::size_t survived = 0; // tracked envs left after the last collection
+    GcStats stats;
+};
+
+Registry& registry()
+{
+    static Registry registry;
+    return registry;
+}
+
+} // namespace
+
+// Heap graph walk over the objects reachable from the tracked envs.
+class HeapGraph final : ReferenceVisitor {
+public:
+    using Object = std::variant<Env const*, Node::Core const*>;
+
+    struct Info {
+        long use_count;
+        long traced_refs = 0;
+        bool marked = false;
+    };
+
+    explicit HeapGraph(std::vector<std::shared_ptr<Env>> const& envs)
+    {
+        // count the traced references to every reachable object
+        std::vector<Object> pending;
+        for (auto const& env : envs) {
+            // the snapshot in `envs` holds one reference of its own
+            if (_objects.emplace(env.get(), Info{env.use_count() - 1}).second) {
+                pending.push_back(env.get());
+            }
+        }
+        _on_edge = [this, &pending](Object object, long use_count) {
+            auto [it, inserted] = _objects.emplace(object, Info{use_count});
+            it->second.traced_refs += 1;
+            if (inserted) {
+                pending.push_back(object);
+            }
+        };
+        walk(pending);
+
+        // objects held from outside the traced graph are roots; mark from them
+        for (auto& [object, info] : _objects) {
+            if (info.use_count > info.traced_refs) {
+                info.marked = true;
+                pending.push_back(object);
+            }
+        }
+        _on_edge = [this, &pending](Object object, long /*use_count*/) {
+            auto& info = _objects.at(object);
+            if (!info.marked) {
+                info.marked = true;
+                pending.push_back(object);
+            }
+        };
+        walk(pending);
+    }
+
+    bool marked(Env const* env) const
+    {
+        return _objects.at(env).marked;
+    }
+
+    std::size_t unmarked_cores() const
+    {
+        std::size_t count = 0;
+        for (auto const& [object, info] : _objects) {
+            if (!info.marked && std::holds_alternative<Node::Core const*>(object)) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+private:
+    void walk(std::vector<Object>& pending)
+    {
+        while (!pending.empty()) {
+            auto object = pending.back();
+            pending.pop_back();
+            if (auto env = std::get_if<Env const*>(&object)) {
+                visit((*env)->_base);
+                if ((*env)->_capture) {
+                    visit((*env)->_capture->twin);
+                }
+                for (auto const& [id, node] : (*env)->_vars) {
+                    visit(node);
+                }
+                for (auto const& cell : (*env)->_cells) {
+                    visit(cell.value);
+                }
+                for (auto const& node : (*env)->_slots) {
+                    visit(node);
+                }
+            }
+            else {
+                std::get<Node::Core const*>(object)->trace(*this);
+            }
+        }
+    }
+
+    void visit(Node const& node) override
+    {
+        if (auto core = node.core()) {
+            _on_edge(core, core->use_count());
+        }
+    }
+
+    void visit(List const& list) override
+    {
+        if (auto const& core = list.core()) {
+            _on_edge(static_cast<Node::Core const*>(core.get()), core->use_count());
+        }
+    }
+
+    void visit(std::shared_ptr<Env> const& env) override
+    {
+        if (env) {
+            _on_edge(env.get(), env.use_count());
+        }
+    }
+
+    std::unordered_map<Object, Info> _objects;
+    std::function<void(Object, long)> _on_edge;
+};
+
+void GarbageCollector::enable(bool enable)
+{
+    registry().enabled = enable;
+}
+
+bool GarbageCollector::enabled()
+{
+    return registry().enabled;
+}
+
+GcStats GarbageCollector::collect()
+{
+    auto& reg = registry();
+
+    std::vector<std::shared_ptr<Env>> envs;
+    {
+        std::lock_guard<std::mutex> lock{reg.mutex};
+        envs.reserve(reg.count);
+        for (auto env = reg.head; env; env = env->_gc_next) {
+            // skip envs whose last reference is being dropped right now
+            if (auto sp = env->weak_from_this().lock()) {
+                envs.push_back(std::move(sp));
+            }
+        }
+    }
+
+    std::size_t collected_envs = 0;
+    std::size_t collected_nodes = 0;
+    {
+        HeapGraph graph{envs};
+        collected_nodes = graph.unmarked_cores();
+        for (auto& env : envs) {
+            if (!graph.marked(env.get())) {
+                env->_base.reset();
+                env->_vars.clear();
+                env->_cells.clear();
+                env->_slots.clear();
+                if (auto twin = env->twin()) {
+                    twin->_capture->origin = nullptr;
+                }
+                env->_capture.reset();
+                ++collected_envs;
+            }
+        }
+    }
+    envs.clear(); // may destroy envs, which untrack themselves
+    if (collected_envs > 0) {
+        Env::bump_version(); // the collected ones lost their bindings
+    }
+
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    reg.survived = reg.count;
+    reg.stats.collections += 1;
+    reg.stats.last_collected_envs = collected_envs;
+    reg.stats.last_collected_nodes = collected_nodes;
+    reg.stats.total_collected_envs += collected_envs;
+    reg.stats.total_collected_nodes += collected_nodes;
+    reg.stats.tracked_envs = reg.count;
+    return reg.stats;
+}
+
+void GarbageCollector::collect_if_needed()
+{
+    auto& reg = registry();
+    if (!reg.enabled) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock{reg.mutex};
+        if (reg.count < std::max(min_collect_threshold, reg.survived * 2)) {
+            return;
+        }
+    }
+    collect();
+}
+
+GcStats GarbageCollector::stats()
+{
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    auto stats = reg.stats;
+    stats.tracked_envs = reg.count;
+    return stats;
+}
+
+void GarbageCollector::track(Env& env)
+{
+    auto& reg = registry();
+    if (!reg.enabled || env._gc_tracked) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    env._gc_tracked = true;
+    env._gc_next = reg.head;
+    if (reg.head) {
+        reg.head->_gc_prev = &env;
+    }
+    reg.head = &env;
+    reg.count += 1;
+}
+
+void GarbageCollector::untrack(Env& env)
+{
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock{reg.mutex};
+    if (env._gc_prev) {
+        env._gc_prev->_gc_next = env._gc_next;
+    }
+    else {
+        reg.head = env._gc_next;
+    }
+    if (env._gc_next) {
+        env._gc_next->_gc_prev = env._gc_prev;
+    }
+    reg.count -= 1;
+}
+
+} // namespace mll
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mll {
+
+class Env;
+
+struct GcStats {
+    std::size_t collections = 0;
+    std::size_t tracked_envs = 0;          // envs currently tracked
+    std::size_t last_collected_envs = 0;   // envs cleared by the last collection
+    std::size_t last_collected_nodes = 0;  // unreachable cores found by the last collection
+    std::size_t total_collected_envs = 0;
+    std::size_t total_collected_nodes = 0;
+};
+
+// Reference counting never frees a cycle, such as a closure defined in the
+// environment it captures. While enabled, the envs a cycle can go through are
+// tracked, and `collect()` clears the tracked envs that are only reachable
+// from garbage; reference counting then frees everything those envs kept
+// alive.
+//
+// Every such cycle has a node holding an env in it: a closure holding the env
+// it keeps (see Env::capture), or a global lookup cache holding an env without
+// slots. So root envs, forks and derived envs without slots are tracked when
+// they are made, and lambda frames only once a closure keeps them; calls that
+// leave no closure behind never take the registry's lock.
+//
+// There is no explicit root set: an object referenced more often than the
+// traced references account for is held from outside (the C++ stack of an
+// evaluation in progress, the embedder, ...) and is a root. A collection may
+// therefore run at any point of an evaluation, but not while another thread
+// is mutating environments that share objects with the tracked ones.
+class GarbageCollector {
+public:
+    static void enable(bool);
+    static bool enabled();
+
+    static GcStats collect();
+    static void collect_if_needed(); // once the number of tracked envs doubles
+    static GcStats stats();
+
+private:
+    friend class Env;
+    static void track(Env&);
+    static void untrack(Env&);
+};
+
+} // namespace mll
@@ -0,0 +1,286 @@
+#include <mll/lambda.hpp>
+
+#include <mll/analyze.hpp>
+#include <mll/bytecode.hpp>
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/list.hpp>
+#include <mll/scope.hpp>
+#include <mll/symbol.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace mll {
+
+namespace {
+
+std::vector<Symbol> slot_names_of(List const& formal_args)
+{
+    std::vector<Symbol> slot_names;
+    for_each(formal_args, [&slot_names](Node const& node) {
+        auto sym = dynamic_node_cast<Symbol>(node);
+        assert(sym.has_value());
+        slot_names.push_back(is_variadic_arg(*sym) ? Symbol{sym->name().substr(1)} : *sym);
+    });
+    return slot_names;
+}
+
+bool names_slot(std::vector<Symbol> const& slot_names, Symbol const& sym)
+{
+    return std::any_of(slot_names.begin(), slot_names.end(),
+                       [&sym](Symbol const& name) { return name.id() == sym.id(); });
+}
+
+// The symbols in the body other than the formal arguments
+std::vector<Symbol> free_symbols(std::vector<Symbol> const& slot_names, std::vector<Symbol> symbols)
+{
+    symbols.erase(std::remove_if(symbols.begin(), symbols.end(),
+                                 [&slot_names](Symbol const& sym) { return names_slot(slot_names, sym); }),
+                  symbols.end());
+    return symbols;
+}
+
+bool calls_only_special_forms(List const& exprs, std::vector<Symbol> const& slot_names);
+
+// Whether every call in `expr` is to a special form other than `macro` by name
+// (see bound_special_form), or to a lambda made in place. Any other operator,
+// a lambda argument included, may be bound to a macro, now or later, whose
+// expansion names bindings `expr` does not; the frame they are in may be gone
+// by then, so that cannot wait for the binding to change.
+bool calls_only_special_forms(Node const& expr, std::vector<Symbol> const& slot_names)
+{
+    auto list = List::from_node(expr);
+    if (!list || list->empty()) {
+        return true;
+    }
+    auto const op = Symbol::from_node(car(*list));
+    if (!op) {
+        return calls_only_special_forms(*list, slot_names);
+    }
+    if (names_slot(slot_names, *op)) {
+        return false;
+    }
+
+    switch (bound_special_form(*op)) {
+    case SpecialForm::none:
+    case SpecialForm::macro:
+        return false;
+    case SpecialForm::quote:
+        return true;
+    case SpecialForm::cond:
+        for (auto clauses = cdr(*list); !clauses.empty(); clauses = cdr(clauses)) {
+            auto clause = List::from_node(car(clauses));
+            if (!clause || !calls_only_special_forms(*clause, slot_names)) {
+                return false;
+            }
+        }
+        return true;
+    case SpecialForm::lambda: {
+        auto args = cdr(*list);
+        auto formal_args = args.empty() ? std::nullopt : List::from_node(car(args));
+        if (!formal_args) {
+            return false;
+        }
+        auto inner = slot_names;
+        for (auto c = *formal_args; !c.empty(); c = cdr(c)) {
+            auto sym = Symbol::from_node(car(c));
+            if (!sym) {
+                return false;
+            }
+            inner.push_back(is_variadic_arg(*sym) ? Symbol{sym->name().substr(1)} : *sym);
+        }
+        return calls_only_special_forms(cdr(args), inner);
+    }
+    case SpecialForm::define:
+    case SpecialForm::set:
+        return calls_only_special_forms(cdr(*list), slot_names);
+    }
+    return false;
+}
+
+bool calls_only_special_forms(List const& exprs, std::vector<Symbol> const& slot_names)
+{
+    for (auto c = exprs; !c.empty(); c = cdr(c)) {
+        if (!calls_only_special_forms(car(c), slot_names)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// What a lambda made in `outer_env` keeps of it: only the bindings its body
+// names (see Env::capture), unless the body calls procs that may name others.
+std::shared_ptr<Env> kept_env(std::shared_ptr<Env> const& outer_env, std::vector<Symbol> const& slot_names,
+                              std::vector<Symbol> const& symbols, List const& body)
+{
+    if (!calls_only_special_forms(body, slot_names)) {
+        return outer_env->capture();
+    }
+    return outer_env->capture(free_symbols(slot_names, symbols));
+}
+
+bool ends_variadic(List formal_args)
+{
+    if (formal_args.empty()) {
+        return false;
+    }
+    while (!cdr(formal_args).empty()) {
+        formal_args = cdr(formal_args);
+    }
+    auto sym = dynamic_node_cast<Symbol>(car(formal_args));
+    assert(sym.has_value());
+    return is_variadic_arg(*sym);
+}
+
+std::vector<std::shared_ptr<Code const>> analyze_body(List const& body, std::shared_ptr<Scope const> const& scope)
+{
+    std::vector<std::shared_ptr<Code const>> codes;
+    for_each(body, [&codes, &scope](Node const& expr) { codes.push_back(analyze(expr, scope)); });
+    return codes;
+}
+} // namespace
+
+bool is_variadic_arg(Symbol const& sym)
+{
+    return sym.name().size() > 1 && sym.name()[0] == '*';
+}
+
+Proc make_lambda(std::string name, List const& formal_args, List const& body, std::shared_ptr<Env> const& outer_env)
+{
+    return Proc{make_ref<LambdaCore>(std::move(name), formal_args, body, outer_env)};
+}
+
+LambdaCore::LambdaCore(std::string name, List const& f, List const& b, std::shared_ptr<Env> const& e)
+    : LambdaCore{std::move(name), f, b, e, slot_names_of(f), symbols_in(b)}
+{}
+
+LambdaCore::LambdaCore(std::string name, List const& f, List const& b, std::shared_ptr<Env> const& e,
+                       std::vector<Symbol> slot_names, std::vector<Symbol> const& symbols)
+    : Core{std::move(name)},
+      formal_args{f},
+      body{b},
+      outer_env{kept_env(e, slot_names, symbols, b)},
+      scope{std::make_shared<Scope const>(std::move(slot_names), symbols, *outer_env)},
+      variadic{ends_variadic(f)},
+      arity{length(f) - (variadic ? 1 : 0)},
+      body_code{analyze_body(b, scope)}
+{}
+
+Node LambdaCore::call(List const& args, Env& env, TailCall& tail)
+{
+    auto lambda_env = derive_frame();
+    auto rest = args;
+    auto syms = formal_args;
+    for (size_t slot = 0; !syms.empty(); ++slot) {
+        auto sym = dynamic_node_cast<Symbol>(car(syms));
+        assert(sym.has_value());
+
+        if (is_variadic_arg(*sym)) {
+            lambda_env->set_slot(slot, map(rest, [&env](Node const& node) { return eval(node, env); }));
+            rest = nil;
+            break;
+        }
+
+        if (rest.empty()) {
+            throw EvalError("Proc: too few args");
+        }
+
+        lambda_env->set_slot(slot, eval(car(rest), env));
+        syms = cdr(syms);
+        rest = cdr(rest);
+    }
+
+    if (!rest.empty()) {
+        throw EvalError("Proc: too many args");
+    }
+
+    // Analyzed code runs nested calls on the native stack, which the stack
+    // evaluator is there to avoid; it gets the body expressions instead.
+    if (eval_mode() != EvalMode::stack) {
+        return enter(std::move(lambda_env), tail);
+    }
+
+    if (body.empty()) {
+        return nil;
+    }
+
+    // the last expression is a tail call; leave it to the caller
+    auto exprs = body;
+    for (; !cdr(exprs).empty(); exprs = cdr(exprs)) {
+        eval(car(exprs), *lambda_env);
+    }
+    tail = TailCall{car(exprs), std::move(lambda_env)};
+    return {};
+}
+
+LambdaCore const* LambdaCore::lambda() const
+{
+    return this;
+}
+
+void LambdaCore::trace(ReferenceVisitor& visitor) const
+{
+    visitor.visit(formal_args);
+    visitor.visit(body);
+    visitor.visit(outer_env);
+    for (auto const& code : body_code) {
+        code->trace(visitor);
+    }
+    if (_chunk) {
+        _chunk->trace(visitor);
+    }
+}
+
+std::shared_ptr<Env> LambdaCore::derive_frame() const
+{
+    return outer_env->derive_new(scope);
+}
+
+std::shared_ptr<Env> LambdaCore::bind(Values values) const
+{
+    if (values.size() < arity) {
+        throw EvalError("Proc: too few args");
+    }
+    if (values.size() > arity && !variadic) {
+        throw EvalError("Proc: too many args");
+    }
+    auto frame = derive_frame();
+    for (size_t slot = 0; slot < arity; ++slot) {
+        frame->set_slot(slot, values[slot]);
+    }
+    if (variadic) {
+        List rest;
+        for (auto i = values.size(); i > arity; --i) {
+            rest = cons(values[i - 1], rest);
+        }
+        frame->set_slot(arity, rest);
+    }
+    return frame;
+}
+
+Node LambdaCore::enter(std::shared_ptr<Env> frame, TailCall& tail) const
+{
+    if (body_code.empty()) {
+        return nil;
+    }
+
+    // the last expression is a tail call; leave it to the caller
+    for (auto it = body_code.begin(); it != body_code.end() - 1; ++it) {
+        execute(**it, *frame);
+    }
+    tail.env = std::move(frame);
+    tail.code = body_code.back();
+    return {};
+}
+
+std::shared_ptr<Chunk const> const& LambdaCore::chunk() const
+{
+    if (!_chunk) {
+        _chunk = compile_body(body, scope, *outer_env);
+    }
+    return _chunk;
+}
+
+} // namespace mll
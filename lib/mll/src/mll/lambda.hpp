@@ -0,0 +1,66 @@
+#pragma once
+
+#include <mll/list.hpp>
+#include <mll/proc.hpp>
+
+#include <vector>
+
+namespace mll {
+
+struct Chunk;
+class Code;
+class Scope;
+class Symbol;
+
+// A formal argument named `*name` binds the list of the remaining arguments
+// to `name`. It must be the last formal argument.
+bool is_variadic_arg(Symbol const&);
+
+// Creates a proc that binds its evaluated arguments to `formal_args` in a new
+// frame derived from `outer_env`, then evaluates `body` there. `formal_args`
+// must be a list of symbols. `body` is analyzed here, once (see analyze.hpp).
+// Made in a lambda frame, the proc keeps only the bindings its body names
+// (see Env::capture), not the frame with all of its arguments, unless the
+// body calls anything but special forms: any other name may be bound to a
+// macro, now or later, that names bindings the body does not.
+Proc make_lambda(std::string name, List const& formal_args, List const& body, std::shared_ptr<Env> const& outer_env);
+
+// The core of the procs made by make_lambda. The stack evaluator (see
+// EvalMode) applies lambdas itself, from `body`, rather than through call().
+struct LambdaCore final : Proc::Core {
+    LambdaCore(std::string name, List const& formal_args, List const& body, std::shared_ptr<Env> const& outer_env);
+
+    Node call(List const& args, Env& env, TailCall& tail) override;
+    LambdaCore const* lambda() const override;
+    void trace(ReferenceVisitor& visitor) const override;
+
+    // A new frame for one call, with a slot for each formal argument.
+    std::shared_ptr<Env> derive_frame() const;
+
+    // A new frame with its slots bound to `values`, as they are.
+    std::shared_ptr<Env> bind(Values values) const; // throws EvalError
+
+    // Runs the analyzed body in `frame`, whose slots are bound, leaving the
+    // last expression in `tail`.
+    Node enter(std::shared_ptr<Env> frame, TailCall& tail) const;
+
+    // The body compiled to bytecode (see bytecode.hpp), on first use.
+    std::shared_ptr<Chunk const> const& chunk() const;
+
+    List const formal_args;
+    List const body;
+    std::shared_ptr<Env> const outer_env; // as kept by Env::capture
+    std::shared_ptr<Scope const> const scope;
+
+    bool const variadic;
+    size_t const arity; // formal args other than the variadic one
+    std::vector<std::shared_ptr<Code const>> const body_code;
+
+private:
+    LambdaCore(std::string name, List const& formal_args, List const& body, std::shared_ptr<Env> const& outer_env,
+               std::vector<Symbol> slot_names, std::vector<Symbol> const& symbols);
+
+    mutable std::shared_ptr<Chunk const> _chunk;
+};
+
+} // namespace mll
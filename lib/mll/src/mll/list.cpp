@@ -4,23 +4,12 @@ namespace mll {
 
 List const nil;
 
-List::List(List const& other) : _core{other._core}
+List::List(Node const& head, List const& tail) : _core{make_ref<Core>(head, tail)}
 {}
 
-List::List(Node const& head, List const& tail) : _core{std::make_shared<Core>(head, tail)}
+List::List(Ref<Core> core) : _core{std::move(core)}
 {}
 
-List::List(std::shared_ptr<Core> const& core) : _core{core}
-{}
-
-List& List::operator=(List const& rhs)
-{
-    if (this != &rhs) {
-        _core = rhs._core;
-    }
-    return *this;
-}
-
 bool List::empty() const
 {
     return !_core;
@@ -36,29 +25,51 @@ List List::tail() const
     return _core ? _core->tail : nil;
 }
 
-std::shared_ptr<List::Core> const& List::core() const
+Ref<List::Core> const& List::core() const
 {
     return _core;
 }
 
 std::optional<List> List::from_node(Node const& node)
 {
-    if (!node.core()) {
+    if (node.is_nil()) {
         return nil;
     }
 
-    if (auto core = std::dynamic_pointer_cast<Core>(node.core())) {
-        return List{core};
+    if (auto core = node.core(); core && core->type == Core::Type::list) {
+        return List{Ref<Core>{static_cast<Core*>(core)}};
     }
     return std::nullopt;
 }
 
-List::Core::Core(Node const& h, List const& t) : head{h}, tail{t}
+List::Core::Core(Node const& h, List const& t) : Node::Core{Type::list}, head{h}, tail{t}
 {}
 
+List::Core::~Core()
+{
+    // Releasing `tail` would free the next cell from within this destructor,
+    // and so on down the list, overflowing the stack on long lists. Unlink
+    // the cells this one owns exclusively and free them in a loop instead.
+    auto next = const_cast<List&>(tail)._core.detach();
+    while (next && next->use_count() == 1) {
+        auto following = const_cast<List&>(next->tail)._core.detach();
+        delete next;
+        next = following;
+    }
+    if (next) {
+        next->release();
+    }
+}
+
 void List::Core::accept(NodeVisitor& visitor)
 {
-    visitor.visit(List{std::static_pointer_cast<Core>(shared_from_this())});
+    visitor.visit(List{Ref<Core>{this}});
+}
+
+void List::Core::trace(ReferenceVisitor& visitor) const
+{
+    visitor.visit(head);
+    visitor.visit(tail);
 }
 
 } // namespace mll
\ No newline at end of file
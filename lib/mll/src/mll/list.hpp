@@ -7,30 +7,28 @@ namespace mll {
 class List final {
 public:
     List() = default;
-
-    List(List const&);
     List(Node const& head, List const& tail);
 
-    List& operator=(List const& rhs);
-
     bool empty() const;
 
     Node head() const;
     List tail() const;
 
     struct Core;
-    std::shared_ptr<Core> const& core() const;
+    Ref<Core> const& core() const;
 
     static std::optional<List> from_node(Node const&);
 
 private:
-    List(std::shared_ptr<Core> const&);
-    std::shared_ptr<Core> _core;
+    explicit List(Ref<Core>);
+    Ref<Core> _core;
 };
 
 struct List::Core : Node::Core {
     Core(Node const& h, List const& t);
+    ~Core() override;
     void accept(NodeVisitor& visitor) final;
+    void trace(ReferenceVisitor& visitor) const final;
 
     Node const head;
     List const tail;
@@ -7,40 +7,51 @@
 
 namespace mll {
 
-Node::Node(Node const& other) : _core{other._core}
+Node::Node(List const& list) : Node{Ref<Core>{list.core()}}
 {}
 
-Node::Node(List const& list) : _core{list.core()}
+Node::Node(Proc const& proc) : Node{Ref<Core>{proc.core()}}
 {}
 
-Node::Node(Proc const& proc) : _core{proc.core()}
+Node::Node(Symbol const& symbol)
+    : _immediate_type{&Symbol::immediate_type}, _bits{reinterpret_cast<std::uintptr_t>(symbol.core())}
 {}
 
-Node::Node(Symbol const& symbol) : _core{symbol.core()}
+Node::Node(Custom const& custom) : Node{custom._node}
 {}
 
-Node::Node(Custom const& custom) : _core{custom.core()}
+Node::Node(Ref<Core> core) : _bits{reinterpret_cast<std::uintptr_t>(core.detach())}
 {}
 
-Node& Node::operator=(Node const& rhs)
-{
-    _core = rhs._core;
-    return *this;
-}
+Node::Node(ImmediateType const& type, std::uint64_t bits) : _immediate_type{&type}, _bits{bits}
+{}
 
 void Node::accept(NodeVisitor& visitor) const
 {
-    if (_core) {
-        _core->accept(visitor);
+    if (auto core = this->core()) {
+        core->accept(visitor);
+    }
+    else if (_immediate_type) {
+        _immediate_type->accept(*this, visitor);
     }
     else {
         visitor.visit(nil);
     }
 }
 
-std::shared_ptr<Node::Core> const& Node::core() const
+Node::ImmediateType const* Node::immediate_type() const
+{
+    return _immediate_type;
+}
+
+std::uint64_t Node::immediate_bits() const
+{
+    return _bits;
+}
+
+bool Node::is_nil() const
 {
-    return _core;
+    return !_immediate_type && !_bits;
 }
 
-} // namespace mll
\ No newline at end of file
+} // namespace mll
@@ -1,10 +1,31 @@
 #pragma once
 
+#include <mll/alloc.hpp>
+#include <mll/ref.hpp>
+
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <stack>
 #include <string>
 
+// Node cores count their references atomically, so nodes may be shared
+// between threads. Single-threaded embedders can build with
+// MLL_ATOMIC_REFCOUNT=0 to use plain integers instead.
+#ifndef MLL_ATOMIC_REFCOUNT
+#define MLL_ATOMIC_REFCOUNT 1
+#endif
+
+// Like libstdc++'s shared_ptr, skip the atomic read-modify-writes while glibc
+// reports that the process has never started a second thread.
+#if MLL_ATOMIC_REFCOUNT && defined(__has_include)
+#if __has_include(<sys/single_threaded.h>)
+#include <sys/single_threaded.h>
+#define MLL_SINGLE_THREADED_HINT __libc_single_threaded
+#endif
+#endif
+
 namespace mll {
 
 class Node;
@@ -12,6 +33,7 @@ class List;
 class Proc;
 class Symbol;
 class Custom;
+class Env;
 
 class NodeVisitor {
 public:
@@ -21,33 +43,185 @@ public:
     virtual void visit(Custom const&) = 0;
 };
 
+// Receives the strong references a Core holds (see Node::Core::trace). The
+// references are passed as they are stored so that the garbage collector can
+// inspect them without taking copies.
+class ReferenceVisitor {
+public:
+    virtual void visit(Node const&) = 0;
+    virtual void visit(List const&) = 0;
+    virtual void visit(std::shared_ptr<Env> const&) = 0;
+};
+
 class Node final {
 public:
     Node() = default;
     Node(Node const&);
+    Node(Node&&) noexcept;
     Node(List const&);
     Node(Proc const&);
     Node(Symbol const&);
     Node(Custom const&);
+    ~Node();
 
-    Node& operator=(Node const& rhs);
+    Node& operator=(Node rhs) noexcept;
 
     void accept(NodeVisitor&) const;
 
-    struct Core : std::enable_shared_from_this<Core> {
+    struct Core {
+        // Concrete kind of the core, so that casts from a Node are a compare
+        // and a static_cast rather than a dynamic_cast.
+        enum class Type : std::uint8_t { list, proc, custom };
+
+        explicit Core(Type t) : type{t}
+        {}
+        Core(Core const&) = delete;
+        Core& operator=(Core const&) = delete;
         virtual ~Core() = default;
+
         virtual void accept(NodeVisitor&) = 0;
+
+        // Reports every Node, List and Env this core keeps alive. Cores that
+        // hold references they do not report are treated by the garbage
+        // collector as roots for them, so leaving this out is safe.
+        virtual void trace(ReferenceVisitor&) const
+        {}
+
+        // Intrusive reference count, managed by Ref
+        void retain() const;
+        void release() const;
+        long use_count() const;
+
+        static void* operator new(std::size_t size)
+        {
+            return allocate_core(size);
+        }
+
+        static void operator delete(void* ptr, std::size_t size)
+        {
+            deallocate_core(ptr, size);
+        }
+
+        Type const type;
+
+    private:
+#if MLL_ATOMIC_REFCOUNT
+        mutable std::atomic<long> _refs{0};
+#else
+        mutable long _refs = 0;
+#endif
+    };
+    explicit Node(Ref<Core>);
+    Core* core() const; // null for nil and immediates
+
+    // Immediates are stored inline in the node: 64 bits of payload tagged with
+    // the address of a static descriptor of their type. Copying one never
+    // touches a reference count, and creating one never allocates.
+    struct ImmediateType {
+        void (*accept)(Node const&, NodeVisitor&);
     };
-    std::shared_ptr<Core> const& core() const;
+    Node(ImmediateType const&, std::uint64_t bits);
+    ImmediateType const* immediate_type() const;
+    std::uint64_t immediate_bits() const;
+
+    bool is_nil() const;
 
 private:
-    std::shared_ptr<Core> _core;
+    friend bool eq(Node const&, Node const&);
+
+    // the core pointer, or the immediate value if `_immediate_type` is set
+    ImmediateType const* _immediate_type = nullptr;
+    std::uint64_t _bits = 0;
 };
 
+inline void Node::Core::retain() const
+{
+#if MLL_ATOMIC_REFCOUNT
+#ifdef MLL_SINGLE_THREADED_HINT
+    if (MLL_SINGLE_THREADED_HINT) {
+        _refs.store(_refs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+#endif
+    _refs.fetch_add(1, std::memory_order_relaxed);
+#else
+    ++_refs;
+#endif
+}
+
+inline void Node::Core::release() const
+{
+#if MLL_ATOMIC_REFCOUNT
+    long refs;
+#ifdef MLL_SINGLE_THREADED_HINT
+    if (MLL_SINGLE_THREADED_HINT) {
+        refs = _refs.load(std::memory_order_relaxed);
+        _refs.store(refs - 1, std::memory_order_relaxed);
+    }
+    else
+#endif
+    {
+        refs = _refs.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    if (refs == 1) {
+        delete this;
+    }
+#else
+    if (--_refs == 0) {
+        delete this;
+    }
+#endif
+}
+
+inline long Node::Core::use_count() const
+{
+#if MLL_ATOMIC_REFCOUNT
+    return _refs.load(std::memory_order_relaxed);
+#else
+    return _refs;
+#endif
+}
+
+inline Node::Node(Node const& other) : _immediate_type{other._immediate_type}, _bits{other._bits}
+{
+    if (auto core = this->core()) {
+        core->retain();
+    }
+}
+
+inline Node::Node(Node&& other) noexcept
+    : _immediate_type{std::exchange(other._immediate_type, nullptr)}, _bits{std::exchange(other._bits, 0)}
+{}
+
+inline Node::~Node()
+{
+    if (auto core = this->core()) {
+        core->release();
+    }
+}
+
+inline Node& Node::operator=(Node rhs) noexcept
+{
+    std::swap(_immediate_type, rhs._immediate_type);
+    std::swap(_bits, rhs._bits);
+    return *this;
+}
+
+inline Node::Core* Node::core() const
+{
+    return _immediate_type ? nullptr : reinterpret_cast<Core*>(static_cast<std::uintptr_t>(_bits));
+}
+
 template <typename T>
 inline std::optional<T> dynamic_node_cast(Node const& node)
 {
     return T::from_node(node);
 }
 
+// Identity comparison: the same heap object, or the same immediate value.
+inline bool eq(Node const& lhs, Node const& rhs)
+{
+    return lhs._immediate_type == rhs._immediate_type && lhs._bits == rhs._bits;
+}
+
 } // namespace mll
@@ -148,12 +148,10 @@ namespace mll {
 std::optional<Node> Parser::parse(std::istream& istream)
 {
     auto make_custom_or_symbol = [this](Token const& token) -> Node {
-        std::shared_ptr<Custom::Core> custom_data;
         if (_custom_data_func) {
-            custom_data = _custom_data_func(token.text, token.is_double_quoted);
-        }
-        if (custom_data) {
-            return Custom{custom_data};
+            if (auto custom = _custom_data_func(token.text, token.is_double_quoted)) {
+                return *custom;
+            }
         }
         return Symbol{token.text};
     };
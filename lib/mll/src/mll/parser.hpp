@@ -21,8 +21,7 @@ public:
     std::optional<Node> parse(std::istream&); // throws ParseError
     bool clean() const;
 
-    using CustomDataFunc =
-        std::function<std::shared_ptr<Custom::Core>(std::string const& /*token*/, bool /*is_quoted*/)>;
+    using CustomDataFunc = std::function<std::optional<Custom>(std::string const& /*token*/, bool /*is_quoted*/)>;
     void set_custom_data_func(CustomDataFunc);
 
 private:
@@ -83,7 +83,7 @@ private:
     {
         assert(_ostream);
 
-        custom.core()->print(*_ostream, _context);
+        custom.print(*_ostream, _context);
     }
 
     void visit(Symbol const& sym) override
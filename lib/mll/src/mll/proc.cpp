@@ -1,14 +1,114 @@
 #include <mll/proc.hpp>
 
+#include <mll/analyze.hpp>
+#include <mll/eval.hpp>
+#include <mll/list.hpp>
+#include <mll/print.hpp>
+#include <mll/symbol.hpp>
+
+#include <array>
+#include <cassert>
+#include <string>
+#include <vector>
+
 namespace mll {
 
-Proc::Proc(std::string name, Func func) : _core{std::make_shared<Core>(std::move(name), std::move(func))}
-{}
+namespace {
+struct FuncCore : Proc::Core {
+    FuncCore(std::string n, Func f) : Core{std::move(n)}, func{std::move(f)}
+    {}
+
+    Node call(List const& args, Env& env, TailCall& /*tail*/) override
+    {
+        if (func) {
+            return func(args, env);
+        }
+        return {};
+    }
+
+    Func const func;
+};
+
+struct TailFuncCore : Proc::Core {
+    TailFuncCore(std::string n, TailFunc f, Analyzer a, SpecialForm s)
+        : Core{std::move(n)}, func{std::move(f)}, analyzer{std::move(a)}, form{s}
+    {}
+
+    Node call(List const& args, Env& env, TailCall& tail) override
+    {
+        return func(args, env, tail);
+    }
+
+    std::unique_ptr<Code const> analyze(List const& form, std::shared_ptr<Scope const> const& scope) const override
+    {
+        return analyzer ? analyzer(cdr(form), scope) : nullptr;
+    }
+
+    SpecialForm special_form() const override
+    {
+        return form;
+    }
+
+    TailFunc const func;
+    Analyzer const analyzer;
+    SpecialForm const form;
+};
+
+struct ApplicativeCore : Proc::Core {
+    ApplicativeCore(std::string n, Func f) : Core{std::move(n)}, func{std::move(f)}
+    {}
+
+    Node call(List const& args, Env& env, TailCall& /*tail*/) override
+    {
+        return func(map(args, [&env](Node const& node) { return eval(node, env); }), env);
+    }
+
+    bool applicative() const override
+    {
+        return true;
+    }
+
+    Node apply(List const& values, Env& env) override
+    {
+        return func(values, env);
+    }
+
+    Func const func;
+};
+// Calls `core` with the values `value_of` makes of the nodes of `list`,
+// gathered in place.
+template <typename ValueOf>
+Node apply_gathered(Proc::Core& core, List const& list, Env& env, ValueOf&& value_of)
+{
+    constexpr std::size_t small_count = 8; // gathered without allocating
+
+    auto const count = length(list);
+    if (count <= small_count) {
+        std::array<Node, small_count> values;
+        auto value = values.begin();
+        for_each(list, [&value, &value_of](Node const& node) { *value++ = value_of(node); });
+        return core.apply_values(Values{values.data(), count}, env);
+    }
+
+    std::vector<Node> values;
+    values.reserve(count);
+    for_each(list, [&values, &value_of](Node const& node) { values.push_back(value_of(node)); });
+    return core.apply_values(Values{values.data(), count}, env);
+}
+
+// Symbol::Core::bindings holds 0 for symbols never bound, and the special form
+// they are bound to plus one otherwise; SpecialForm::none once they have been
+// bound to anything else, which sticks.
+std::uint8_t binding_tag(SpecialForm form)
+{
+    return static_cast<std::uint8_t>(static_cast<std::uint8_t>(form) + 1);
+}
+} // namespace
 
-Proc::Proc(Proc const& other) : _core{other._core}
+Proc::Proc(std::string name, Func func) : _core{make_ref<FuncCore>(std::move(name), std::move(func))}
 {}
 
-Proc::Proc(std::shared_ptr<Core> core) : _core{core}
+Proc::Proc(Ref<Core> core) : _core{std::move(core)}
 {}
 
 const std::string& Proc::name() const
@@ -18,31 +118,126 @@ const std::string& Proc::name() const
 
 Node Proc::call(List const& args, Env& env) const
 {
-    if (_core->func) {
-        return _core->func(args, env);
+    TailCall tail;
+    auto result = _core->call(args, env, tail);
+    if (!tail.env) {
+        return result;
     }
-    return {};
+    return tail.code ? execute(*tail.code, *tail.env) : eval(tail.expr, *tail.env);
 }
 
-std::shared_ptr<Proc::Core> const& Proc::core() const
+Ref<Proc::Core> const& Proc::core() const
 {
     return _core;
 }
 
 std::optional<Proc> Proc::from_node(Node const& node)
 {
-    if (auto core = std::dynamic_pointer_cast<Core>(node.core())) {
-        return Proc{core};
+    if (auto core = node.core(); core && core->type == Core::Type::proc) {
+        return Proc{Ref<Core>{static_cast<Core*>(core)}};
     }
     return std::nullopt;
 }
 
-Proc::Core::Core(std::string n, Func f) : name{std::move(n)}, func{std::move(f)}
+Proc::Core::Core(std::string n) : Node::Core{Type::proc}, name{std::move(n)}
 {}
 
 void Proc::Core::accept(NodeVisitor& visitor)
 {
-    visitor.visit(Proc{std::static_pointer_cast<Core>(shared_from_this())});
+    visitor.visit(Proc{Ref<Core>{this}});
+}
+
+Node Proc::Core::apply(List const& /*values*/, Env& /*env*/)
+{
+    assert(false); // only for applicative procs
+    return {};
+}
+
+Node Proc::Core::apply_values(Values values, Env& env)
+{
+    List list;
+    for (auto i = values.size(); i > 0; --i) {
+        list = cons(values[i - 1], list);
+    }
+    return apply(list, env);
+}
+
+Node Proc::Core::call_form(List const& form, Env& env, TailCall& tail)
+{
+    return call(cdr(form), env, tail);
+}
+
+std::unique_ptr<Code const> Proc::Core::analyze(List const& /*form*/,
+                                                std::shared_ptr<Scope const> const& /*scope*/) const
+{
+    return nullptr;
+}
+
+Proc make_tail_proc(std::string name, TailFunc func)
+{
+    return make_tail_proc(std::move(name), std::move(func), nullptr);
+}
+
+Proc make_tail_proc(std::string name, TailFunc func, Analyzer analyzer)
+{
+    return Proc{make_ref<TailFuncCore>(std::move(name), std::move(func), std::move(analyzer), SpecialForm::none)};
+}
+
+Proc make_special_form(std::string name, SpecialForm form, TailFunc func, Analyzer analyzer)
+{
+    return Proc{make_ref<TailFuncCore>(std::move(name), std::move(func), std::move(analyzer), form)};
+}
+
+SpecialForm bound_special_form(Symbol const& sym)
+{
+    auto const tag = sym.core()->bindings.load(std::memory_order_relaxed);
+    return tag == 0 ? SpecialForm::none : static_cast<SpecialForm>(tag - 1);
+}
+
+void note_binding(Symbol const& sym, Node const& value)
+{
+    auto form = SpecialForm::none;
+    if (auto proc = Proc::from_node(value)) {
+        form = proc->core()->special_form();
+    }
+
+    auto& bindings = sym.core()->bindings;
+    auto const tag = binding_tag(form);
+    auto old = bindings.load(std::memory_order_relaxed);
+    while (old != tag && old != binding_tag(SpecialForm::none)) {
+        auto const next = old == 0 ? tag : binding_tag(SpecialForm::none);
+        if (bindings.compare_exchange_weak(old, next, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+}
+
+NativeCore::NativeCore(std::string n, std::size_t a) : Core{std::move(n)}, arity{a}
+{}
+
+Node NativeCore::call(List const& args, Env& env, TailCall& /*tail*/)
+{
+    return apply_gathered(*this, args, env, [&env](Node const& arg) { return eval(arg, env); });
+}
+
+Node NativeCore::apply(List const& values, Env& env)
+{
+    return apply_gathered(*this, values, env, [](Node const& value) { return value; });
+}
+
+void NativeCore::throw_argc() const
+{
+    throw EvalError(name + " expects " + std::to_string(arity) + " argument(s).");
+}
+
+void NativeCore::throw_type_error(Node const& value, char const* expected) const
+{
+    throw EvalError(name + ": " + std::to_string(value) + " is not " + expected + ".");
+}
+
+Proc make_applicative_proc(std::string name, Func func)
+{
+    return Proc{make_ref<ApplicativeCore>(std::move(name), std::move(func))};
 }
 
-} // namespace mll
\ No newline at end of file
+} // namespace mll
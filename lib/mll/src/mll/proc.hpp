@@ -2,36 +2,268 @@
 
 #include <mll/node.hpp>
 
+#include <cstddef>
 #include <functional>
+#include <type_traits>
+#include <utility>
 
 namespace mll {
 
+class Code;
 class Env;
+class Scope;
+class Symbol;
+struct LambdaCore;
+
+// An expression a proc leaves for its caller to evaluate in `env`, in place
+// of evaluating it itself and returning the value. eval() evaluates it in a
+// loop, so that calls in tail position run in constant native stack.
+struct TailCall {
+    TailCall() = default;
+    TailCall(Node e, std::shared_ptr<Env> v) : expr{std::move(e)}, env{std::move(v)}
+    {}
+
+    Node expr;
+    std::shared_ptr<Env> env; // null if the proc returned a value
+
+    // If set, the analyzed form of `expr` (see analyze.hpp), run in its place
+    std::shared_ptr<Code const> code;
+};
+
+// The values of the arguments of a call, in place (see Proc::Core::apply_values)
+class Values final {
+public:
+    Values(Node const* data, std::size_t size) : _data{data}, _size{size}
+    {}
+
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    Node const& operator[](std::size_t i) const
+    {
+        return _data[i];
+    }
+
+    Node const* begin() const
+    {
+        return _data;
+    }
+
+    Node const* end() const
+    {
+        return _data + _size;
+    }
+
+private:
+    Node const* _data;
+    std::size_t _size;
+};
+
 using Func = std::function<Node(List const&, Env&)>;
+using TailFunc = std::function<Node(List const&, Env&, TailCall&)>;
+
+// Core special forms. Calls to them are recognized by the name of the operator
+// (see bound_special_form); the bytecode compiler builds the semantics of some
+// of them in (see bytecode.hpp).
+enum class SpecialForm : std::uint8_t {
+    none,
+    quote,  // (quote datum)
+    cond,   // (cond (test expr)...): the expr of the first test that is not nil
+    lambda, // (lambda (formal...) expr...): make_lambda in the calling env
+    define, // (define name expr)
+    set,    // (set! name expr)
+    macro,  // (macro (formal...) expr)
+};
+
+// Analyzes the unevaluated arguments of a call (see Proc::Core::analyze).
+using Analyzer = std::function<std::unique_ptr<Code const>(List const&, std::shared_ptr<Scope const> const&)>;
 
 class Proc final {
 public:
     Proc(std::string name, Func);
-    Proc(Proc const&);
 
     const std::string& name() const;
     Node call(List const&, Env&) const;
 
     struct Core;
-    std::shared_ptr<Core> const& core() const;
+    Ref<Core> const& core() const;
 
+    explicit Proc(Ref<Core>);
     static std::optional<Proc> from_node(Node const&);
 
 private:
-    Proc(std::shared_ptr<Core>);
-    std::shared_ptr<Core> _core;
+    Ref<Core> _core;
 };
 
 struct Proc::Core : Node::Core {
-    Core(std::string, Func);
+    explicit Core(std::string);
     void accept(NodeVisitor& visitor) final;
+    // Either returns the result, or fills in `tail` (see TailCall).
+    virtual Node call(List const&, Env&, TailCall& tail) = 0;
+
+    // call() with the arguments of `form`, the unevaluated call (op arg...)
+    // itself. Evaluators call procs that take their arguments unevaluated
+    // through this, so that a proc keeping state per call site, as macros do,
+    // can key it by the cons cell of the form; calls without arguments have
+    // one too.
+    virtual Node call_form(List const& form, Env&, TailCall& tail);
+
+    // Non-null for lambdas (see make_lambda)
+    virtual LambdaCore const* lambda() const
+    {
+        return nullptr;
+    }
+
+    // Applicative procs (see make_applicative_proc and make_native_proc) take
+    // the values of their arguments, evaluated by the caller, through apply(),
+    // or through apply_values() without consing them into a list. Either one
+    // conses or unpacks the values for the other by default.
+    virtual bool applicative() const
+    {
+        return false;
+    }
+    virtual Node apply(List const& values, Env&);
+    virtual Node apply_values(Values values, Env&);
+
+    // Lets a proc that takes its arguments unevaluated analyze `form`, a call to
+    // it in analyzed code (see analyze.hpp). The call site runs the analyzed
+    // code in place of call_form() for as long as its operator evaluates to
+    // this proc. Returns null if the call is to go through call_form().
+    virtual std::unique_ptr<Code const> analyze(List const& form, std::shared_ptr<Scope const> const&) const;
+
+    virtual SpecialForm special_form() const
+    {
+        return SpecialForm::none;
+    }
 
     std::string const name;
-    Func const func;
 };
-} // namespace mll
\ No newline at end of file
+
+// Makes a native proc that may defer the evaluation of its result to the
+// caller through TailCall.
+Proc make_tail_proc(std::string name, TailFunc);
+Proc make_tail_proc(std::string name, TailFunc, Analyzer);
+
+// Makes a native proc, like make_tail_proc, that implements `form`.
+Proc make_special_form(std::string name, SpecialForm form, TailFunc, Analyzer = nullptr);
+
+// The special form implemented by every proc `sym` has been bound to, in any
+// env, if it has only ever been bound to procs implementing that one form;
+// SpecialForm::none otherwise. While it holds, a call whose operator is `sym`,
+// and not a lambda argument, is a call to the special form wherever `sym` is
+// bound, so it can be dispatched without looking `sym` up.
+SpecialForm bound_special_form(Symbol const& sym);
+
+// Records that `sym` is being bound to `value`, for bound_special_form.
+void note_binding(Symbol const& sym, Node const& value);
+
+// Makes a native proc whose arguments are evaluated, left to right, before
+// `func` is called with the list of their values.
+Proc make_applicative_proc(std::string name, Func);
+
+// The core of the procs made by make_native_proc, less the call to the func:
+// evaluates or unpacks the arguments into a buffer for apply_values().
+struct NativeCore : Proc::Core {
+    static constexpr std::size_t variadic = static_cast<std::size_t>(-1);
+
+    NativeCore(std::string name, std::size_t arity);
+
+    Node call(List const& args, Env& env, TailCall& tail) final;
+    bool applicative() const final
+    {
+        return true;
+    }
+    Node apply(List const& values, Env& env) final;
+
+    [[noreturn]] void throw_argc() const;                                          // throws EvalError
+    [[noreturn]] void throw_type_error(Node const& value, char const* expected) const; // throws EvalError
+
+    std::size_t const arity; // or `variadic`
+};
+
+// Arity of the funcs make_native_proc takes: one `Node const&` per argument,
+// or `Values` for any number of them, optionally followed by `Env&`.
+template <typename Func>
+struct NativeSignature : NativeSignature<decltype(&Func::operator())> {};
+
+template <typename... Args>
+struct NativeArgs {
+    template <typename Arg>
+    static constexpr bool is_env = std::is_same_v<Arg, Env&>;
+
+    static constexpr bool takes_env = (is_env<Args> || ...);
+    static constexpr std::size_t count = sizeof...(Args) - (takes_env ? 1 : 0);
+    static constexpr bool takes_values = (std::is_same_v<std::decay_t<Args>, Values> || ...);
+    static constexpr std::size_t arity = takes_values ? NativeCore::variadic : count;
+};
+
+template <typename R, typename... Args>
+struct NativeSignature<R (*)(Args...)> : NativeArgs<Args...> {};
+
+template <typename C, typename R, typename... Args>
+struct NativeSignature<R (C::*)(Args...)> : NativeArgs<Args...> {};
+
+template <typename C, typename R, typename... Args>
+struct NativeSignature<R (C::*)(Args...) const> : NativeArgs<Args...> {};
+
+template <typename Func>
+struct NativeFuncCore final : NativeCore {
+    using Signature = NativeSignature<Func>;
+
+    NativeFuncCore(std::string name, Func f) : NativeCore{std::move(name), Signature::arity}, func{std::move(f)}
+    {}
+
+    Node apply_values(Values values, Env& env) override
+    {
+        if constexpr (Signature::takes_values) {
+            return invoke(env, values);
+        }
+        else {
+            if (values.size() != Signature::arity) {
+                throw_argc();
+            }
+            return invoke_with(values, env, std::make_index_sequence<Signature::arity>{});
+        }
+    }
+
+    template <std::size_t... I>
+    Node invoke_with(Values values, Env& env, std::index_sequence<I...>)
+    {
+        return invoke(env, values[I]...);
+    }
+
+    template <typename... Args>
+    Node invoke(Env& env, Args const&... args)
+    {
+        if constexpr (Signature::takes_env) {
+            return func(args..., env);
+        }
+        else {
+            (void)env;
+            return func(args...);
+        }
+    }
+
+    Func func;
+};
+
+// Makes an applicative proc whose arguments are passed to `func` in place,
+// without consing a list, as typed by its signature (see NativeSignature):
+//
+//     make_native_proc("cons", [](Node const& head, Node const& tail) { ... });
+//     make_native_proc("list", [](Values values) { ... });
+//
+// Calls with another number of arguments than `func` takes raise EvalError.
+template <typename Func>
+Proc make_native_proc(std::string name, Func func)
+{
+    return Proc{make_ref<NativeFuncCore<Func>>(std::move(name), std::move(func))};
+}
+} // namespace mll
@@ -1,5 +1,6 @@
 #include <mll/quote.hpp>
 
+#include <mll/analyze.hpp>
 #include <mll/env.hpp>
 #include <mll/eval.hpp>
 #include <mll/list.hpp>
@@ -120,7 +121,12 @@ void load_quote_procs(Env& env)
 {
     auto defun = [&env](char const* cmd, Func func) { env.set(cmd, Proc{cmd, std::move(func)}); };
 
-    defun(SYMBOL_QUOTE, [](List const& args, Env& /*env*/) { return car(args); });
+    env.set(SYMBOL_QUOTE, make_special_form(
+                              SYMBOL_QUOTE, SpecialForm::quote,
+                              [](List const& args, Env& /*env*/, TailCall& /*tail*/) { return car(args); },
+                              [](List const& args, std::shared_ptr<Scope const> const& /*scope*/) {
+                                  return make_constant(car(args));
+                              }));
 
     defun(SYMBOL_QUASIQUOTE, [](List const& args, Env& env) {
         auto node = car(args);
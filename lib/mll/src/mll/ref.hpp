@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace mll {
+
+// Owning pointer to an object that keeps its own reference count, which it
+// exposes as `retain()` and `release()`; `release()` destroys the object
+// when the count drops to zero. See Node::Core.
+template <typename T>
+class Ref final {
+public:
+    Ref() = default;
+
+    Ref(std::nullptr_t)
+    {}
+
+    explicit Ref(T* ptr) : _ptr{ptr}
+    {
+        if (_ptr) {
+            _ptr->retain();
+        }
+    }
+
+    Ref(Ref const& other) : Ref{other._ptr}
+    {}
+
+    Ref(Ref&& other) noexcept : _ptr{std::exchange(other._ptr, nullptr)}
+    {}
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    Ref(Ref<U> const& other) : Ref{other.get()}
+    {}
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    Ref(Ref<U>&& other) noexcept : _ptr{other.detach()}
+    {}
+
+    ~Ref()
+    {
+        if (_ptr) {
+            _ptr->release();
+        }
+    }
+
+    Ref& operator=(Ref other) noexcept
+    {
+        std::swap(_ptr, other._ptr);
+        return *this;
+    }
+
+    T* get() const
+    {
+        return _ptr;
+    }
+
+    T& operator*() const
+    {
+        return *_ptr;
+    }
+
+    T* operator->() const
+    {
+        return _ptr;
+    }
+
+    explicit operator bool() const
+    {
+        return _ptr != nullptr;
+    }
+
+    // Gives up ownership without releasing.
+    T* detach()
+    {
+        return std::exchange(_ptr, nullptr);
+    }
+
+private:
+    T* _ptr = nullptr;
+};
+
+template <typename T, typename U>
+inline bool operator==(Ref<T> const& lhs, Ref<U> const& rhs)
+{
+    return lhs.get() == rhs.get();
+}
+
+template <typename T, typename U>
+inline bool operator!=(Ref<T> const& lhs, Ref<U> const& rhs)
+{
+    return lhs.get() != rhs.get();
+}
+
+template <typename T, typename... Args>
+inline Ref<T> make_ref(Args&&... args)
+{
+    return Ref<T>{new T(std::forward<Args>(args)...)};
+}
+
+} // namespace mll
@@ -0,0 +1,97 @@
+#include <mll/scope.hpp>
+
+#include <mll/env.hpp>
+#include <mll/list.hpp>
+
+#include <algorithm>
+
+namespace mll {
+
+namespace {
+void collect_symbols(Node const& node, std::vector<Symbol>& symbols)
+{
+    if (auto sym = dynamic_node_cast<Symbol>(node)) {
+        symbols.push_back(*sym);
+    }
+    else if (auto list = dynamic_node_cast<List>(node)) {
+        for_each(*list, [&symbols](Node const& n) { collect_symbols(n, symbols); });
+    }
+}
+
+std::optional<size_t> find_slot_of(std::vector<Symbol> const& slot_names, std::uint32_t id)
+{
+    // later formals shadow earlier ones of the same name
+    for (auto i = slot_names.size(); i > 0; --i) {
+        if (slot_names[i - 1].id() == id) {
+            return i - 1;
+        }
+    }
+    return std::nullopt;
+}
+} // namespace
+
+Scope::Scope(std::vector<Symbol> slot_names, List const& body, Env const& outer_env)
+    : Scope{std::move(slot_names), symbols_in(body), outer_env}
+{}
+
+Scope::Scope(std::vector<Symbol> slot_names, std::vector<Symbol> const& symbols, Env const& outer_env)
+    : _slot_names{std::move(slot_names)}
+{
+    _addresses.reserve(symbols.size());
+    for (auto const& sym : symbols) {
+        _addresses.emplace_back(sym.id(), Address{0, Address::global});
+    }
+
+    for (auto& [id, address] : _addresses) {
+        if (auto slot = find_slot_of(_slot_names, id)) {
+            address.slot = *slot;
+            continue;
+        }
+        address.depth = 1;
+        for (auto env = &outer_env; env && env->_scope; env = env->_base.get(), ++address.depth) {
+            if (auto slot = find_slot_of(env->_scope->_slot_names, id)) {
+                address.slot = *slot;
+                break;
+            }
+        }
+    }
+}
+
+size_t Scope::size() const
+{
+    return _slot_names.size();
+}
+
+Symbol const& Scope::slot_name(size_t slot) const
+{
+    return _slot_names[slot];
+}
+
+std::optional<size_t> Scope::find_slot(Symbol const& sym) const
+{
+    return find_slot_of(_slot_names, sym.id());
+}
+
+Scope::Address const* Scope::resolve(Symbol const& sym) const
+{
+    auto const id = sym.id();
+    auto it = std::lower_bound(_addresses.begin(), _addresses.end(), id,
+                               [](Entry const& e, std::uint32_t i) { return e.first < i; });
+    if (it != _addresses.end() && it->first == id) {
+        return &it->second;
+    }
+    return nullptr;
+}
+
+std::vector<Symbol> symbols_in(List const& body)
+{
+    std::vector<Symbol> symbols;
+    collect_symbols(body, symbols);
+    std::sort(symbols.begin(), symbols.end(), [](auto const& l, auto const& r) { return l.id() < r.id(); });
+    symbols.erase(std::unique(symbols.begin(), symbols.end(),
+                              [](auto const& l, auto const& r) { return l.id() == r.id(); }),
+                  symbols.end());
+    return symbols;
+}
+
+} // namespace mll
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mll/symbol.hpp>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace mll {
+
+class Env;
+class List;
+
+// Static layout of a lambda frame. Slots hold the formal arguments in order.
+// Every symbol that appears in the lambda body is resolved once, when the
+// lambda is created, to the number of slot frames to skip and the slot to read
+// there. Symbols that are not bound by any enclosing slot frame resolve to
+// `Address::global`: skip `depth` slot frames, then look the name up.
+class Scope final {
+public:
+    struct Address {
+        static constexpr size_t global = static_cast<size_t>(-1);
+
+        size_t depth;
+        size_t slot;
+    };
+
+    Scope(std::vector<Symbol> slot_names, List const& body, Env const& outer_env);
+
+    // Takes the symbols in the body as found by symbols_in().
+    Scope(std::vector<Symbol> slot_names, std::vector<Symbol> const& symbols, Env const& outer_env);
+
+    size_t size() const;
+    Symbol const& slot_name(size_t slot) const;
+    std::optional<size_t> find_slot(Symbol const&) const;
+
+    Address const* resolve(Symbol const&) const;
+
+private:
+    using Entry = std::pair<std::uint32_t, Address>; // symbol id, address
+
+    std::vector<Symbol> const _slot_names;
+    std::vector<Entry> _addresses; // sorted by symbol id
+};
+
+// The symbols that appear in `body`, each once, sorted by id.
+std::vector<Symbol> symbols_in(List const& body);
+
+} // namespace mll
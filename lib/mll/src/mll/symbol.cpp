@@ -1,27 +1,175 @@
 #include <mll/symbol.hpp>
 
-#include <map>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <vector>
 
 namespace mll {
 
-Symbol::Symbol(std::string name)
+namespace {
+
+// FNV-1a
+std::size_t hash_name(std::string_view name)
 {
-    thread_local std::map<std::string, std::shared_ptr<Core>> symbols;
+    std::uint64_t hash = 14695981039346656037ull;
+    for (auto c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return static_cast<std::size_t>(hash);
+}
+
+// Process-wide intern table, split into shards by hash. Each shard is an
+// open-addressing (linear probing) table of pointers to interned cores.
+//
+// Lookups are lock-free: a slot goes from empty to its final value exactly
+// once, and a grown table is fully populated before it is published, so a
+// reader sees either a complete old table or a complete new one. Writers take
+// the shard's mutex and re-probe before inserting. Retired tables are kept
+// until exit because readers may still be probing them; with doubling, they
+// never add up to more than the live table.
+class SymbolTable {
+public:
+    Symbol::Core const* find(std::string_view name, std::size_t hash) const
+    {
+        return shard_of(hash).find(name, hash);
+    }
+
+    Symbol::Core const& intern(std::string_view name)
+    {
+        auto const hash = hash_name(name);
+        auto& shard = shard_of(hash);
+        if (auto core = shard.find(name, hash)) {
+            return *core;
+        }
+        return shard.insert(name, hash, _next_id);
+    }
+
+private:
+    static constexpr std::size_t shard_bits = 4;
+    static constexpr std::size_t initial_capacity = 64; // must be a power of 2
+
+    struct Table {
+        explicit Table(std::size_t capacity)
+            : mask{capacity - 1}, slots{new std::atomic<Symbol::Core const*>[capacity]}
+        {
+            for (std::size_t i = 0; i < capacity; ++i) {
+                slots[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        std::size_t const mask;
+        std::unique_ptr<std::atomic<Symbol::Core const*>[]> const slots;
+    };
+
+    class Shard {
+    public:
+        Shard()
+        {
+            _tables.push_back(std::make_unique<Table>(initial_capacity));
+            _table.store(_tables.back().get(), std::memory_order_release);
+        }
+
+        Symbol::Core const* find(std::string_view name, std::size_t hash) const
+        {
+            auto const table = _table.load(std::memory_order_acquire);
+            for (auto i = hash & table->mask;; i = (i + 1) & table->mask) {
+                auto const core = table->slots[i].load(std::memory_order_acquire);
+                if (!core) {
+                    return nullptr;
+                }
+                if (core->hash == hash && core->name == name) {
+                    return core;
+                }
+            }
+        }
+
+        Symbol::Core const& insert(std::string_view name, std::size_t hash, std::atomic<std::uint32_t>& next_id)
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+
+            // another thread may have won the race for the same name
+            if (auto core = find(name, hash)) {
+                return *core;
+            }
+
+            auto table = _table.load(std::memory_order_relaxed);
+            if ((_cores.size() + 1) * 2 > table->mask + 1) {
+                table = grow(*table);
+            }
+
+            auto const id = next_id.fetch_add(1, std::memory_order_relaxed);
+            auto const& core = _cores.emplace_back(name, id, hash);
+            store(*table, &core);
+            return core;
+        }
+
+    private:
+        static void store(Table& table, Symbol::Core const* core)
+        {
+            auto i = core->hash & table.mask;
+            while (table.slots[i].load(std::memory_order_relaxed)) {
+                i = (i + 1) & table.mask;
+            }
+            table.slots[i].store(core, std::memory_order_release);
+        }
+
+        Table* grow(Table const& table)
+        {
+            auto grown = std::make_unique<Table>((table.mask + 1) * 2);
+            for (auto const& core : _cores) {
+                store(*grown, &core);
+            }
+            _table.store(grown.get(), std::memory_order_release);
+            _tables.push_back(std::move(grown));
+            return _tables.back().get();
+        }
+
+        std::atomic<Table*> _table;
+        std::mutex _mutex;
+        std::vector<std::unique_ptr<Table>> _tables; // current one is last
+        std::deque<Symbol::Core> _cores;             // stable addresses
+    };
+
+    // Shards are picked by the top bits so the low bits still spread entries
+    // within a shard's table.
+    static std::size_t shard_index(std::size_t hash)
+    {
+        return hash >> (std::numeric_limits<std::size_t>::digits - shard_bits);
+    }
 
-    auto i = symbols.find(name);
-    if (i == symbols.end()) {
-        _core = std::make_shared<Core>(std::move(name));
-        symbols.insert(std::make_pair(_core->name, _core));
+    Shard& shard_of(std::size_t hash)
+    {
+        return _shards[shard_index(hash)];
     }
-    else {
-        _core = i->second;
+
+    Shard const& shard_of(std::size_t hash) const
+    {
+        return _shards[shard_index(hash)];
     }
+
+    std::array<Shard, std::size_t{1} << shard_bits> _shards;
+    std::atomic<std::uint32_t> _next_id{0};
+};
+
+SymbolTable& symbol_table()
+{
+    static SymbolTable table;
+    return table;
 }
 
+} // namespace
+
+Symbol::Symbol(std::string_view name) : _core{&symbol_table().intern(name)}
+{}
+
 Symbol::Symbol(Symbol const& other) : _core{other._core}
 {}
 
-Symbol::Symbol(std::shared_ptr<Core> core) : _core{core}
+Symbol::Symbol(Core const* core) : _core{core}
 {}
 
 std::string const& Symbol::name() const
@@ -29,25 +177,36 @@ std::string const& Symbol::name() const
     return _core->name;
 }
 
-std::shared_ptr<Symbol::Core> const& Symbol::core() const
+std::uint32_t Symbol::id() const
 {
-    return _core;
+    return _core->id;
 }
 
-std::optional<Symbol> Symbol::from_node(Node const& node)
+std::optional<Symbol> Symbol::find(std::string_view name)
 {
-    if (auto core = std::dynamic_pointer_cast<Core>(node.core())) {
+    if (auto core = symbol_table().find(name, hash_name(name))) {
         return Symbol{core};
     }
     return std::nullopt;
 }
 
-Symbol::Core::Core(std::string n) : name{std::move(n)}
-{}
+Symbol::Core const* Symbol::core() const
+{
+    return _core;
+}
 
-void Symbol::Core::accept(NodeVisitor& visitor)
+std::optional<Symbol> Symbol::from_node(Node const& node)
 {
-    visitor.visit(Symbol{std::static_pointer_cast<Core>(shared_from_this())});
+    if (node.immediate_type() == &immediate_type) {
+        return Symbol{reinterpret_cast<Core const*>(static_cast<std::uintptr_t>(node.immediate_bits()))};
+    }
+    return std::nullopt;
 }
 
-} // namespace mll
\ No newline at end of file
+Node::ImmediateType const Symbol::immediate_type{
+    [](Node const& node, NodeVisitor& visitor) { visitor.visit(*from_node(node)); }};
+
+Symbol::Core::Core(std::string_view n, std::uint32_t i, std::size_t h) : name{n}, id{i}, hash{h}
+{}
+
+} // namespace mll
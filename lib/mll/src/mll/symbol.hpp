@@ -2,29 +2,50 @@
 
 #include <mll/node.hpp>
 
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
 namespace mll {
 
 class Symbol final {
 public:
-    explicit Symbol(std::string);
+    explicit Symbol(std::string_view);
     Symbol(Symbol const&);
 
     std::string const& name() const;
 
+    // Dense process-wide id (0, 1, 2, ...) usable as a key in place of the
+    // name. Symbols are interned process-wide, so the same name yields the same
+    // core (and id) on every thread.
+    std::uint32_t id() const;
+
+    // Returns the symbol only if `name` has been interned already; never
+    // creates one.
+    static std::optional<Symbol> find(std::string_view name);
+
+    // Interned cores live as long as the process, so symbols (and the nodes
+    // holding them, as immediates) refer to them without reference counting.
     struct Core;
-    std::shared_ptr<Core> const& core() const;
+    Core const* core() const;
 
     static std::optional<Symbol> from_node(Node const&);
+    static Node::ImmediateType const immediate_type;
 
 private:
-    Symbol(std::shared_ptr<Core>);
-    std::shared_ptr<Core> _core;
+    Symbol(Core const*);
+    Core const* _core;
 };
 
-struct Symbol::Core : Node::Core {
-    explicit Core(std::string);
-    void accept(NodeVisitor& visitor) final;
+struct Symbol::Core {
+    Core(std::string_view, std::uint32_t, std::size_t);
 
     std::string const name;
+    std::uint32_t const id;
+    std::size_t const hash;
+
+    // What the symbol has been bound to in any env so far, kept by Env (see
+    // bound_special_form in proc.hpp)
+    mutable std::atomic<std::uint8_t> bindings{0};
 };
-} // namespace mll
\ No newline at end of file
+} // namespace mll
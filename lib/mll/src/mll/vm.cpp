@@ -0,0 +1,369 @@
+#include <mll/bytecode.hpp>
+
+#include <mll/analyze.hpp>
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/lambda.hpp>
+#include <mll/print.hpp>
+#include <mll/proc.hpp>
+
+#include <array>
+#include <cassert>
+#include <iterator>
+#include <string>
+
+// Dispatch by jumping through a table of label addresses (a GNU extension)
+// where the compiler has it, rather than through a switch.
+#if defined(__GNUC__) || defined(__clang__)
+#define MLL_VM_COMPUTED_GOTO 1
+#else
+#define MLL_VM_COMPUTED_GOTO 0
+#endif
+
+namespace mll {
+
+namespace {
+
+Proc to_proc_or_throw(Node const& node)
+{
+    if (auto proc = dynamic_node_cast<Proc>(node)) {
+        return *proc;
+    }
+    throw EvalError(std::to_string(node) + " is not a proc.");
+}
+
+// Runs chunks with an explicit stack of call frames: a lambda called from
+// bytecode runs in a new frame of the same loop, and a tail call replaces
+// the caller's frame. Native procs are called on the native stack. The frames
+// and the value stack are shared by all the VMs nested on a thread.
+class Vm final {
+public:
+    static Node run(std::shared_ptr<Chunk const> chunk, Env& env)
+    {
+        return Vm{}.execute(std::move(chunk), env.shared_from_this());
+    }
+
+private:
+    struct Frame {
+        std::shared_ptr<Chunk const> chunk;
+        std::shared_ptr<Env> env;
+        std::uint32_t pc;  // where the frame resumes once its callee returns
+        std::size_t base; // height of the value stack on entry
+    };
+
+    Vm() : _frame_base{frames().size()}, _value_base{values().size()}
+    {}
+
+    ~Vm()
+    {
+        // unwinding from an error leaves frames and values behind
+        frames().resize(_frame_base);
+        values().resize(_value_base);
+    }
+
+    Vm(Vm const&) = delete;
+    Vm& operator=(Vm const&) = delete;
+
+    static std::vector<Frame>& frames()
+    {
+        thread_local std::vector<Frame> frames;
+        return frames;
+    }
+
+    static std::vector<Node>& values()
+    {
+        thread_local std::vector<Node> values;
+        return values;
+    }
+
+    static void push_frame(std::shared_ptr<Chunk const> chunk, std::shared_ptr<Env> env)
+    {
+        auto& stack = frames();
+        if (stack.size() >= max_eval_depth()) {
+            throw EvalError("Maximum evaluation depth (" + std::to_string(max_eval_depth()) + ") exceeded.");
+        }
+        stack.push_back(Frame{std::move(chunk), std::move(env), 0, values().size()});
+    }
+
+    static Node load(Chunk::Variable const& var, Env& env)
+    {
+        auto value = env.lookup(var.sym, var.address, var.cache);
+        if (!value.has_value()) {
+            throw EvalError("Unknown symbol: " + var.sym.name());
+        }
+        return std::move(*value);
+    }
+
+    // The `count` values from `first` on, as a list
+    static List to_list(std::vector<Node>& values, std::size_t first, std::size_t count)
+    {
+        List list;
+        while (count > 0) {
+            --count;
+            list = cons(std::move(values[first + count]), list);
+        }
+        return list;
+    }
+
+    // Calls the applicative `core` with the `argc` values from `first` on,
+    // popping them and the operator under them. They are moved off the stack
+    // first, since the call may grow it.
+    static Node apply(Proc::Core& core, std::vector<Node>& values, std::size_t first, std::size_t argc, Env& env)
+    {
+        constexpr std::size_t small_count = 8; // moved without allocating
+
+        auto const args = values.begin() + static_cast<std::ptrdiff_t>(first);
+        if (argc <= small_count) {
+            std::array<Node, small_count> moved;
+            std::move(args, values.end(), moved.begin());
+            values.resize(first - 1);
+            return core.apply_values(Values{moved.data(), argc}, env);
+        }
+
+        std::vector<Node> moved{std::make_move_iterator(args), std::make_move_iterator(values.end())};
+        values.resize(first - 1);
+        return core.apply_values(Values{moved.data(), argc}, env);
+    }
+
+    // A frame for `lambda` with its slots bound to the `argc` values from
+    // `first` on
+    static std::shared_ptr<Env> bind(LambdaCore const& lambda, std::vector<Node>& values, std::size_t first,
+                                     std::size_t argc)
+    {
+        if (argc < lambda.arity) {
+            throw EvalError("Proc: too few args");
+        }
+        if (argc > lambda.arity && !lambda.variadic) {
+            throw EvalError("Proc: too many args");
+        }
+        auto frame = lambda.derive_frame();
+        for (std::size_t slot = 0; slot < lambda.arity; ++slot) {
+            frame->set_slot(slot, std::move(values[first + slot]));
+        }
+        if (lambda.variadic) {
+            frame->set_slot(lambda.arity, to_list(values, first + lambda.arity, argc - lambda.arity));
+        }
+        return frame;
+    }
+
+    Node execute(std::shared_ptr<Chunk const> entry, std::shared_ptr<Env> entry_env)
+    {
+        auto& stack = values();
+        push_frame(std::move(entry), std::move(entry_env));
+
+        // registers, loaded from the top frame
+        Chunk const* chunk = nullptr;
+        std::uint32_t const* code = nullptr;
+        std::uint32_t pc = 0;
+        Env* env = nullptr;
+        auto load_frame = [&] {
+            auto const& frame = frames().back();
+            chunk = frame.chunk.get();
+            code = chunk->code.data();
+            pc = frame.pc;
+            env = frame.env.get();
+        };
+        load_frame();
+
+        // operands of native_call
+        CallSite const* site = nullptr;
+        std::optional<Proc> native;
+
+#if MLL_VM_COMPUTED_GOTO
+        static void* const labels[] = {&&op_constant, &&op_load,          &&op_pop,     &&op_enter,
+                                       &&op_special,  &&op_call,          &&op_tail_call, &&op_jump,
+                                       &&op_jump_if_false, &&op_closure, &&op_ret};
+        static_assert(sizeof(labels) / sizeof(labels[0]) == static_cast<std::size_t>(Op::ret) + 1);
+#define MLL_VM_CASE(op) op_##op
+#define MLL_VM_DISPATCH() goto* labels[code[pc++]]
+#else
+#define MLL_VM_CASE(op) case Op::op
+#define MLL_VM_DISPATCH() continue
+#endif
+
+        for (;;) {
+#if MLL_VM_COMPUTED_GOTO
+            MLL_VM_DISPATCH();
+#else
+            switch (static_cast<Op>(code[pc++])) {
+#endif
+
+            MLL_VM_CASE(constant) :
+            {
+                stack.push_back(chunk->constants[code[pc++]]);
+                MLL_VM_DISPATCH();
+            }
+
+            MLL_VM_CASE(load) :
+            {
+                stack.push_back(load(chunk->variables[code[pc++]], *env));
+                MLL_VM_DISPATCH();
+            }
+
+            MLL_VM_CASE(pop) :
+            {
+                stack.pop_back();
+                MLL_VM_DISPATCH();
+            }
+
+            MLL_VM_CASE(enter) :
+            {
+                site = &chunk->sites[code[pc++]];
+                auto proc = to_proc_or_throw(stack.back());
+                if (proc.core()->lambda() || proc.core()->applicative()) {
+                    MLL_VM_DISPATCH(); // to the arguments, then `call`
+                }
+                native = std::move(proc);
+                stack.pop_back();
+                goto native_call;
+            }
+
+            MLL_VM_CASE(special) :
+            {
+                site = &chunk->sites[code[pc++]];
+                auto const& var = chunk->variables[site->variable];
+                if (bound_special_form(var.sym) == site->form) {
+                    MLL_VM_DISPATCH(); // to the form compiled inline
+                }
+                auto proc = to_proc_or_throw(load(var, *env));
+                if (proc.core()->special_form() == site->form) {
+                    MLL_VM_DISPATCH();
+                }
+                native = std::move(proc);
+                goto native_call;
+            }
+
+            MLL_VM_CASE(call) :
+            {
+                auto const argc = code[pc++];
+                auto const first = stack.size() - argc;
+                auto proc = *Proc::from_node(stack[first - 1]);
+                auto const& core = proc.core();
+                if (auto lambda = core->lambda()) {
+                    auto lambda_env = bind(*lambda, stack, first, argc);
+                    stack.resize(first - 1);
+                    frames().back().pc = pc;
+                    push_frame(lambda->chunk(), std::move(lambda_env));
+                    load_frame();
+                    MLL_VM_DISPATCH();
+                }
+                stack.push_back(apply(*core, stack, first, argc, *env));
+                MLL_VM_DISPATCH();
+            }
+
+            MLL_VM_CASE(tail_call) :
+            {
+                auto const argc = code[pc++];
+                auto const first = stack.size() - argc;
+                auto proc = *Proc::from_node(stack[first - 1]);
+                auto const& core = proc.core();
+                if (auto lambda = core->lambda()) {
+                    auto lambda_env = bind(*lambda, stack, first, argc);
+                    auto& frame = frames().back();
+                    stack.resize(frame.base);
+                    frame.chunk = lambda->chunk();
+                    frame.env = std::move(lambda_env);
+                    frame.pc = 0;
+                    load_frame();
+                    MLL_VM_DISPATCH();
+                }
+                stack.push_back(apply(*core, stack, first, argc, *env));
+                MLL_VM_DISPATCH();
+            }
+
+            MLL_VM_CASE(jump) :
+            {
+                pc = code[pc];
+                MLL_VM_DISPATCH();
+            }
+
+            MLL_VM_CASE(jump_if_false) :
+            {
+                auto const target = code[pc++];
+                auto const test = std::move(stack.back());
+                stack.pop_back();
+                if (test.is_nil()) {
+                    pc = target;
+                }
+                MLL_VM_DISPATCH();
+            }
+
+            MLL_VM_CASE(closure) :
+            {
+                auto const& lambda = chunk->lambdas[code[pc++]];
+                stack.push_back(make_lambda("anonymous", lambda.formal_args, lambda.body, frames().back().env));
+                MLL_VM_DISPATCH();
+            }
+
+            MLL_VM_CASE(ret) :
+            {
+                auto value = std::move(stack.back());
+                stack.pop_back();
+                assert(stack.size() == frames().back().base);
+                frames().pop_back();
+                if (frames().size() == _frame_base) {
+                    return value;
+                }
+                load_frame();
+                stack.push_back(std::move(value));
+                MLL_VM_DISPATCH();
+            }
+
+#if !MLL_VM_COMPUTED_GOTO
+            }
+#endif
+
+        // Calls `native` with the call of `site` unevaluated. An
+        // expression it leaves to evaluate is compiled (see CallSite) and run
+        // in a frame of its own, so that macros in tail position run in
+        // constant stack.
+        native_call : {
+            TailCall tail;
+            auto result = native->core()->call_form(site->call, *env, tail);
+            native.reset();
+            auto const expr = tail.code ? std::nullopt : List::from_node(tail.expr);
+            if (tail.env && expr && !expr->empty()) {
+                if (site->tail_expr.core() != tail.expr.core()) {
+                    site->tail_chunk = compile(tail.expr, nullptr, *tail.env);
+                    site->tail_expr = tail.expr;
+                }
+                auto callee = site->tail_chunk;
+                if (site->tail) {
+                    auto& frame = frames().back();
+                    stack.resize(frame.base);
+                    frame.chunk = std::move(callee);
+                    frame.env = std::move(tail.env);
+                    frame.pc = 0;
+                }
+                else {
+                    frames().back().pc = site->end;
+                    push_frame(std::move(callee), std::move(tail.env));
+                }
+                load_frame();
+                MLL_VM_DISPATCH();
+            }
+            if (tail.env) {
+                result = tail.code ? mll::execute(*tail.code, *tail.env) : eval(tail.expr, *tail.env);
+            }
+            stack.push_back(std::move(result));
+            pc = site->end;
+            MLL_VM_DISPATCH();
+        }
+        }
+
+#undef MLL_VM_CASE
+#undef MLL_VM_DISPATCH
+    }
+
+    std::size_t const _frame_base;
+    std::size_t const _value_base;
+};
+
+} // namespace
+
+Node run(std::shared_ptr<Chunk const> chunk, Env& env)
+{
+    return Vm::run(std::move(chunk), env);
+}
+
+} // namespace mll
@@ -0,0 +1,108 @@
+#include <catch2/catch.hpp>
+
+#include <mll/alloc.hpp>
+#include <mll/custom.hpp>
+#include <mll/list.hpp>
+#include <mll/print.hpp>
+#include <mll/symbol.hpp>
+
+#include <algorithm>
+#include <array>
+#include <set>
+#include <thread>
+
+namespace mll {
+
+namespace {
+struct BlobPrinter {
+    template <typename T>
+    static void print(std::ostream& ostream, PrintContext, T const& value)
+    {
+        ostream << value.size() << "-byte blob";
+    }
+};
+
+// boxed in a core larger than the largest size class
+using Blob = CustomType<std::array<char, 300>, BlobPrinter>;
+
+Node make_blob()
+{
+    return Blob{std::array<char, 300>{}};
+}
+
+List make_list(int count)
+{
+    List list;
+    for (int i = 0; i < count; ++i) {
+        list = cons(Symbol{"item"}, list);
+    }
+    return list;
+}
+} // namespace
+
+TEST_CASE("Cores escaping a region stay valid", "[alloc]")
+{
+    List kept;
+    {
+        AllocationRegion region;
+        make_list(10'000);
+        kept = cons(Symbol{"a"}, cons(Symbol{"b"}, nil));
+        make_list(10'000);
+    }
+
+    CHECK(std::to_string(kept) == "(a b)");
+}
+
+TEST_CASE("Regions nest", "[alloc]")
+{
+    AllocationRegion outer;
+    auto list = make_list(100);
+    {
+        AllocationRegion inner;
+        list = cons(Symbol{"x"}, list);
+    }
+    CHECK(length(list) == 101);
+}
+
+TEST_CASE("Region cores may be freed on another thread", "[alloc]")
+{
+    List list;
+    {
+        AllocationRegion region;
+        list = make_list(1'000);
+    }
+    std::thread{[list = std::move(list)]() mutable { list = nil; }}.join();
+    CHECK(length(make_list(10)) == 10);
+}
+
+TEST_CASE("Large cores are allocated apart from pools and regions", "[alloc]")
+{
+    List blobs;
+    {
+        AllocationRegion region;
+        blobs = cons(make_blob(), blobs);
+    }
+    blobs = cons(make_blob(), blobs);
+    std::thread{[blobs = std::move(blobs)]() mutable { blobs = nil; }}.join();
+    CHECK(std::to_string(make_blob()) == "300-byte blob");
+}
+
+TEST_CASE("Pools keep freed cores for reuse", "[alloc]")
+{
+    auto cells_of = [](List list) {
+        std::set<void const*> cells;
+        for (; !list.empty(); list = cdr(list)) {
+            cells.insert(list.core().get());
+        }
+        return cells;
+    };
+
+    auto list = make_list(10'000);
+    auto const freed = cells_of(list);
+    list = nil;
+
+    auto const reused = cells_of(make_list(10'000));
+    CHECK(std::includes(freed.begin(), freed.end(), reused.begin(), reused.end()));
+}
+
+} // namespace mll
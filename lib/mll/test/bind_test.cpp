@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+
+#include <mll/bind.hpp>
+#include <mll/custom.hpp>
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/list.hpp>
+#include <mll/symbol.hpp>
+
+#include <ostream>
+
+namespace mll {
+
+namespace {
+struct IntPrinter {
+    static void print(std::ostream& ostream, PrintContext, int value)
+    {
+        ostream << value;
+    }
+};
+
+using Int = CustomType<int, IntPrinter>;
+
+int add(int lhs, int rhs)
+{
+    return lhs + rhs;
+}
+} // namespace
+
+template <>
+struct NodeConversion<int> {
+    static constexpr char const* expected = "an int";
+    static std::optional<int> from_node(Node const& node)
+    {
+        if (auto i = Int::from_node(node)) {
+            return i->value();
+        }
+        return std::nullopt;
+    }
+    static Node to_node(int value)
+    {
+        return Int{value};
+    }
+};
+
+TEST_CASE("Bound funcs are called with their arguments converted", "[bind]")
+{
+    auto env = Env::create();
+    env->set("one", Int{1});
+    env->set("two", Int{2});
+
+    SECTION("free functions")
+    {
+        auto proc = bind<int(int, int)>("add", add);
+        REQUIRE(proc.core()->applicative());
+
+        auto result = dynamic_node_cast<Int>(proc.call(cons(Symbol{"one"}, cons(Symbol{"two"}, nil)), *env));
+        REQUIRE(result.has_value());
+        REQUIRE(result->value() == 3);
+    }
+
+    SECTION("node types and void results")
+    {
+        Node seen;
+        auto proc = bind<void(Symbol, List const&)>("see", [&seen](Symbol const& sym, List const& list) {
+            seen = cons(sym, list);
+        });
+
+        auto args = cons(cons(Symbol{"quote"}, cons(Symbol{"x"}, nil)), cons(nil, nil));
+        REQUIRE(proc.call(args, *env).is_nil());
+        REQUIRE(dynamic_node_cast<Symbol>(car(*dynamic_node_cast<List>(seen)))->name() == "x");
+    }
+
+    SECTION("type and argument count errors")
+    {
+        auto proc = bind<int(int, int)>("add", add);
+
+        REQUIRE_THROWS_WITH(proc.call(cons(Symbol{"one"}, cons(nil, nil)), *env), "add: () is not an int.");
+        REQUIRE_THROWS_WITH(proc.call(cons(Symbol{"one"}, nil), *env), "add expects 2 argument(s).");
+    }
+}
+
+} // namespace mll
@@ -0,0 +1,57 @@
+#include <catch2/catch.hpp>
+
+#include <mll/bytecode.hpp>
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/lambda.hpp>
+#include <mll/list.hpp>
+#include <mll/parser.hpp>
+#include <mll/print.hpp>
+
+#include <algorithm>
+#include <sstream>
+
+namespace mll {
+
+namespace {
+Node parse(std::string const& text)
+{
+    std::istringstream istream{text};
+    return *Parser{}.parse(istream);
+}
+
+bool emits(Chunk const& chunk, Op op)
+{
+    return std::find(chunk.code.begin(), chunk.code.end(), static_cast<std::uint32_t>(op)) != chunk.code.end();
+}
+
+} // namespace
+
+TEST_CASE("Special forms compile inline while their name is bound to them", "[bytecode]")
+{
+    auto env = Env::create();
+    env->set("bytecode-quote",
+             make_special_form("bytecode-quote", SpecialForm::quote,
+                               [](List const& args, Env& /*env*/, TailCall& /*tail*/) { return car(args); }));
+    auto chunk = compile(parse("(bytecode-quote (a b))"), nullptr, *env);
+    REQUIRE(emits(*chunk, Op::special));
+    REQUIRE(std::to_string(run(chunk, *env)) == "(a b)");
+
+    // the compiled call notices the rebinding and calls the new proc instead
+    env->set("bytecode-quote",
+             Proc{"bytecode-quote", [](List const& args, Env& /*env*/) { return cons(car(args), nil); }});
+    REQUIRE(std::to_string(run(chunk, *env)) == "((a b))");
+}
+
+TEST_CASE("Calls to other procs compile to calls", "[bytecode]")
+{
+    auto env = Env::create();
+    auto chunk = compile(parse("(f 'a)"), nullptr, *env);
+    REQUIRE(emits(*chunk, Op::enter));
+    REQUIRE(emits(*chunk, Op::tail_call));
+
+    env->set("f", make_lambda("f", *List::from_node(parse("(x)")), *List::from_node(parse("(x)")), env));
+    REQUIRE(std::to_string(run(chunk, *env)) == "a");
+}
+
+} // namespace mll
@@ -0,0 +1,62 @@
+#include <catch2/catch.hpp>
+
+#include <mll/custom.hpp>
+#include <mll/list.hpp>
+#include <mll/print.hpp>
+#include <mll/symbol.hpp>
+
+#include <string>
+
+namespace mll {
+
+namespace {
+struct TestPrinter {
+    template <typename T>
+    static void print(std::ostream& ostream, PrintContext, T const& value)
+    {
+        ostream << '<' << value << '>';
+    }
+};
+
+using Double = CustomType<double, TestPrinter>;
+using Text = CustomType<std::string, TestPrinter>;
+struct WordPrinter : TestPrinter {};
+
+using Word = CustomType<std::string, WordPrinter>;
+} // namespace
+
+TEST_CASE("Small trivially copyable custom values are immediates", "[Custom]")
+{
+    static_assert(Double::is_immediate);
+    static_assert(!Text::is_immediate);
+
+    Node node = Double{1.5};
+    REQUIRE(node.core() == nullptr);
+    REQUIRE_FALSE(node.is_nil());
+    REQUIRE(dynamic_node_cast<Double>(node)->value() == 1.5);
+    REQUIRE_FALSE(dynamic_node_cast<Text>(node).has_value());
+    REQUIRE_FALSE(dynamic_node_cast<List>(node).has_value());
+    REQUIRE_FALSE(dynamic_node_cast<Symbol>(node).has_value());
+    REQUIRE(std::to_string(node) == "<1.5>");
+}
+
+TEST_CASE("Other custom values are boxed", "[Custom]")
+{
+    Node node = Text{"abc"};
+    REQUIRE(node.core() != nullptr);
+    REQUIRE(dynamic_node_cast<Text>(node)->value() == "abc");
+    REQUIRE_FALSE(dynamic_node_cast<Double>(node).has_value());
+    REQUIRE_FALSE(dynamic_node_cast<Word>(node).has_value());
+    REQUIRE_FALSE(dynamic_node_cast<List>(node).has_value());
+    REQUIRE(std::to_string(node) == "<abc>");
+}
+
+TEST_CASE("Immediates are eq by value", "[Custom]")
+{
+    REQUIRE(eq(Double{2.0}, Double{2.0}));
+    REQUIRE_FALSE(eq(Double{2.0}, Double{3.0}));
+    REQUIRE(eq(Symbol{"a"}, Symbol{"a"}));
+    REQUIRE_FALSE(eq(Text{"a"}, Text{"a"}));
+}
+
+} // namespace mll
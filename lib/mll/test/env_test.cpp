@@ -0,0 +1,218 @@
+#include <catch2/catch.hpp>
+
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/list.hpp>
+#include <mll/node.hpp>
+#include <mll/scope.hpp>
+#include <mll/symbol.hpp>
+
+#include <array>
+#include <thread>
+#include <vector>
+
+namespace mll {
+
+TEST_CASE("Derived env looks up bindings through its base", "[Env]")
+{
+    auto env = Env::create();
+    env->set("x", Symbol{"a"});
+
+    auto derived = env->derive_new();
+    REQUIRE(derived->deep_lookup("x").has_value());
+    REQUIRE_FALSE(derived->shallow_lookup("x").has_value());
+
+    derived->set("x", Symbol{"b"});
+    REQUIRE(dynamic_node_cast<Symbol>(*derived->deep_lookup("x"))->name() == "b");
+    REQUIRE(dynamic_node_cast<Symbol>(*env->deep_lookup("x"))->name() == "a");
+}
+
+TEST_CASE("Root env binds names bound to nil", "[Env]")
+{
+    auto env = Env::create();
+    REQUIRE_FALSE(env->shallow_lookup("env-test-unbound").has_value());
+    REQUIRE_FALSE(env->shallow_update("env-test-unbound", nil));
+
+    env->set("env-test-nil", nil);
+    REQUIRE(env->shallow_lookup("env-test-nil").has_value());
+    REQUIRE(env->deep_update("env-test-nil", Symbol{"a"}));
+    REQUIRE(dynamic_node_cast<Symbol>(*env->derive_new()->deep_lookup("env-test-nil"))->name() == "a");
+
+    // other root envs have bindings of their own
+    REQUIRE_FALSE(Env::create()->shallow_lookup("env-test-nil").has_value());
+}
+
+TEST_CASE("Derived env does not reinstall quote procs", "[Env]")
+{
+    auto env = Env::create();
+    REQUIRE(env->shallow_lookup("quote").has_value());
+
+    auto derived = env->derive_new();
+    REQUIRE_FALSE(derived->shallow_lookup("quote").has_value());
+    REQUIRE(derived->deep_lookup("quote").has_value());
+}
+
+TEST_CASE("Scoped env resolves symbols to slots", "[Env]")
+{
+    Symbol x{"x"}, y{"y"}, z{"z"};
+    auto body = cons(x, cons(y, cons(z, nil)));
+
+    auto env = Env::create();
+    env->set("z", Symbol{"global"});
+
+    auto outer_scope = std::make_shared<Scope const>(std::vector<Symbol>{x}, body, *env);
+    auto outer = env->derive_new(outer_scope);
+    outer->set_slot(0, Symbol{"outer-x"});
+
+    auto inner_scope = std::make_shared<Scope const>(std::vector<Symbol>{y}, body, *outer);
+    auto inner = outer->derive_new(inner_scope);
+    inner->set_slot(0, Symbol{"inner-y"});
+
+    auto name_of = [](std::optional<Node> const& node) { return dynamic_node_cast<Symbol>(*node)->name(); };
+
+    REQUIRE(name_of(inner->lookup(x)) == "outer-x");
+    REQUIRE(name_of(inner->lookup(y)) == "inner-y");
+    REQUIRE(name_of(inner->lookup(z)) == "global");
+    REQUIRE(name_of(inner->deep_lookup("x")) == "outer-x");
+
+    SECTION("bindings defined later shadow resolved addresses")
+    {
+        inner->set("x", Symbol{"defined-x"});
+        REQUIRE(name_of(inner->lookup(x)) == "defined-x");
+        REQUIRE(name_of(outer->lookup(x)) == "outer-x");
+    }
+
+    SECTION("updates by name reach slots")
+    {
+        REQUIRE(inner->deep_update("x", Symbol{"updated-x"}));
+        REQUIRE(name_of(inner->lookup(x)) == "updated-x");
+    }
+}
+
+TEST_CASE("Global lookups are cached until a binding changes", "[Env]")
+{
+    Symbol x{"x"}, z{"z"};
+    auto body = cons(x, cons(z, nil));
+
+    auto env = Env::create();
+    env->set("z", Symbol{"global"});
+    auto scope = std::make_shared<Scope const>(std::vector<Symbol>{x}, body, *env);
+    auto const address = *scope->resolve(z);
+    REQUIRE(address.slot == Scope::Address::global);
+
+    auto name_of = [](std::optional<Node> const& node) { return dynamic_node_cast<Symbol>(*node)->name(); };
+
+    LookupCache cache;
+    LookupCache::reset_stats();
+    REQUIRE(name_of(env->derive_new(scope)->lookup(z, address, cache)) == "global");
+    REQUIRE(name_of(env->derive_new(scope)->lookup(z, address, cache)) == "global");
+    REQUIRE(LookupCache::stats().misses == 1);
+    REQUIRE(LookupCache::stats().hits == 1);
+
+    SECTION("redefined")
+    {
+        env->set("z", Symbol{"redefined"});
+        REQUIRE(name_of(env->derive_new(scope)->lookup(z, address, cache)) == "redefined");
+        REQUIRE(LookupCache::stats().misses == 2);
+    }
+
+    SECTION("updated")
+    {
+        REQUIRE(env->deep_update("z", Symbol{"updated"}));
+        REQUIRE(name_of(env->derive_new(scope)->lookup(z, address, cache)) == "updated");
+    }
+
+    SECTION("shadowed by a define in the frame")
+    {
+        auto frame = env->derive_new(scope);
+        frame->set("z", Symbol{"defined"});
+        REQUIRE(name_of(frame->lookup(z, address, cache)) == "defined");
+        REQUIRE(name_of(env->derive_new(scope)->lookup(z, address, cache)) == "global");
+    }
+
+    SECTION("looked up from another env")
+    {
+        auto derived = env->derive_new();
+        derived->set("z", Symbol{"derived"});
+        auto other_scope = std::make_shared<Scope const>(std::vector<Symbol>{x}, body, *derived);
+        REQUIRE(name_of(env->derive_new(scope)->lookup(z, address, cache)) == "global");
+        REQUIRE(name_of(derived->derive_new(other_scope)->lookup(z, address, cache)) == "derived");
+    }
+}
+
+TEST_CASE("Forks of a frozen env bind names of their own", "[Env]")
+{
+    auto builtins = Env::create();
+    builtins->set("x", Symbol{"builtin"});
+    auto const frozen = builtins->freeze();
+    REQUIRE(frozen->frozen());
+    REQUIRE_THROWS_AS(builtins->set("y", nil), EvalError);
+    REQUIRE_THROWS_AS(builtins->shallow_update("x", nil), EvalError);
+
+    auto fork = frozen->fork();
+    auto other = frozen->fork();
+    auto name_of = [](std::optional<Node> const& node) { return dynamic_node_cast<Symbol>(*node)->name(); };
+    REQUIRE(name_of(fork->deep_lookup("x")) == "builtin");
+    REQUIRE(fork->deep_lookup("quote").has_value());
+
+    fork->set("y", Symbol{"defined"});
+    REQUIRE(name_of(fork->deep_lookup("y")) == "defined");
+    REQUIRE_FALSE(other->deep_lookup("y").has_value());
+
+    // updates of frozen bindings are copied, from frames below the fork too
+    REQUIRE(fork->derive_new()->deep_update("x", Symbol{"updated"}));
+    REQUIRE(name_of(fork->shallow_lookup("x")) == "updated");
+    REQUIRE(name_of(other->deep_lookup("x")) == "builtin");
+    REQUIRE(name_of(frozen->shallow_lookup("x")) == "builtin");
+    REQUIRE_FALSE(fork->deep_update("unbound", nil));
+
+    // frames on the frozen env itself, e.g. the calls of lambdas defined in it
+    REQUIRE_THROWS_AS(builtins->derive_new()->deep_update("x", Symbol{"lost"}), EvalError);
+    REQUIRE(name_of(frozen->shallow_lookup("x")) == "builtin");
+}
+
+TEST_CASE("Forks of one frozen env may run on several threads", "[Env]")
+{
+    auto builtins = Env::create();
+    builtins->set("x", Symbol{"builtin"});
+    auto const frozen = builtins->freeze();
+
+    std::array<Symbol, 4> const names{Symbol{"one"}, Symbol{"two"}, Symbol{"three"}, Symbol{"four"}};
+    std::array<std::shared_ptr<Env>, 4> forks;
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < forks.size(); ++i) {
+        threads.emplace_back([&frozen, &name = names[i], &fork = forks[i]] {
+            fork = frozen->fork();
+            for (int n = 0; n < 1'000; ++n) {
+                fork->set("y", name);
+                fork->derive_new()->deep_update("x", name);
+                fork->derive_new()->set("z", name);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto name_of = [](std::optional<Node> const& node) { return dynamic_node_cast<Symbol>(*node)->name(); };
+    for (std::size_t i = 0; i < forks.size(); ++i) {
+        REQUIRE(name_of(forks[i]->shallow_lookup("x")) == names[i].name());
+        REQUIRE(name_of(forks[i]->shallow_lookup("y")) == names[i].name());
+        REQUIRE_FALSE(forks[i]->deep_lookup("z").has_value());
+    }
+    REQUIRE(name_of(frozen->shallow_lookup("x")) == "builtin");
+    REQUIRE_FALSE(frozen->shallow_lookup("y").has_value());
+}
+
+TEST_CASE("Only root envs freeze and only frozen envs fork", "[Env]")
+{
+    auto root = Env::create();
+    REQUIRE_THROWS_AS(root->derive_new()->freeze(), EvalError);
+    REQUIRE_THROWS_AS(root->fork(), EvalError);
+
+    auto fork = root->freeze()->fork();
+    REQUIRE_THROWS_AS(fork->freeze(), EvalError);
+    REQUIRE_THROWS_AS(fork->fork(), EvalError);
+}
+
+} // namespace mll
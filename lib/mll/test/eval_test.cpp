@@ -0,0 +1,163 @@
+#include <catch2/catch.hpp>
+
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/lambda.hpp>
+#include <mll/list.hpp>
+#include <mll/parser.hpp>
+#include <mll/print.hpp>
+#include <mll/proc.hpp>
+#include <mll/symbol.hpp>
+
+#include <array>
+#include <limits>
+#include <sstream>
+
+namespace mll {
+
+namespace {
+Node parse(std::string const& text)
+{
+    std::istringstream istream{text};
+    return *Parser{}.parse(istream);
+}
+
+List parse_list(std::string const& text)
+{
+    return *dynamic_node_cast<List>(parse(text));
+}
+
+// (define name (lambda formal_args body...)), without mlisp's primitives
+void define_lambda(Env& env, char const* name, char const* formal_args, char const* body)
+{
+    env.set(name, make_lambda(name, parse_list(formal_args), parse_list(body), env.shared_from_this()));
+}
+
+std::shared_ptr<Env> make_env()
+{
+    auto env = Env::create();
+    env->set("cons", Proc{"cons", [](List const& args, Env& env) {
+                              return cons(eval(car(args), env), *dynamic_node_cast<List>(eval(cadr(args), env)));
+                          }});
+    env->set("cdr", Proc{"cdr", [](List const& args, Env& env) {
+                             return cdr(*dynamic_node_cast<List>(eval(car(args), env)));
+                         }});
+    env->set("if-nil", make_tail_proc("if-nil", [](List const& args, Env& env, TailCall& tail) {
+                 auto branch = eval(car(args), env).is_nil() ? cadr(args) : cadr(cdr(args));
+                 tail = TailCall{branch, env.shared_from_this()};
+                 return Node{};
+             }));
+    define_lambda(*env, "list", "(*items)", "(items)");
+    define_lambda(*env, "second", "(a b)", "(a b)");
+    // copies a list by non-tail recursion through lambdas only
+    define_lambda(*env, "copy", "(l)", "((if-nil l '() (kons 'x (copy (cdr l)))))");
+    define_lambda(*env, "kons", "(a b)", "((cons a b))");
+    // the same, through an applicative native proc
+    env->set("pair", make_native_proc("pair", [](Node const& a, Node const& b) {
+                 return cons(a, *dynamic_node_cast<List>(b));
+             }));
+    define_lambda(*env, "copy-native", "(l)", "((if-nil l '() (pair 'x (copy-native (cdr l)))))");
+    return env;
+}
+
+struct EvalSettings {
+    EvalSettings(EvalMode mode, std::size_t max_depth)
+    {
+        set_eval_mode(mode);
+        set_max_eval_depth(max_depth);
+    }
+
+    ~EvalSettings()
+    {
+        set_eval_mode(old_mode);
+        set_max_eval_depth(old_max_depth);
+    }
+
+    EvalMode const old_mode = eval_mode();
+    std::size_t const old_max_depth = max_eval_depth();
+};
+
+List make_list(int count)
+{
+    List list;
+    for (int i = 0; i < count; ++i) {
+        list = cons(nil, list);
+    }
+    return list;
+}
+} // namespace
+
+TEST_CASE("All eval modes agree", "[eval]")
+{
+    auto mode = GENERATE(EvalMode::recursive, EvalMode::stack, EvalMode::bytecode);
+    EvalSettings settings{mode, 10'000};
+
+    auto env = make_env();
+    REQUIRE(std::to_string(eval(parse("(list 'a 'b (second 'c 'd))"), *env)) == "(a b d)");
+    REQUIRE(std::to_string(eval(parse("(list)"), *env)) == "()");
+    REQUIRE(length(*dynamic_node_cast<List>(eval(parse("(copy '(1 2 3))"), *env))) == 3);
+    REQUIRE_THROWS_AS(eval(parse("(second 'a)"), *env), EvalError);
+    REQUIRE_THROWS_AS(eval(parse("(second 'a 'b 'c)"), *env), EvalError);
+    REQUIRE_THROWS_AS(eval(parse("('a)"), *env), EvalError);
+}
+
+TEST_CASE("apply() passes values to procs without evaluating them", "[eval]")
+{
+    auto mode = GENERATE(EvalMode::recursive, EvalMode::stack, EvalMode::bytecode);
+    EvalSettings settings{mode, 10'000};
+
+    auto env = make_env();
+    auto const proc = [&env](char const* name) { return *dynamic_node_cast<Proc>(*env->lookup(Symbol{name})); };
+
+    // the symbols would be unknown if they were evaluated
+    std::array<Node, 3> const values{Symbol{"a"}, Symbol{"b"}, parse("(c)")};
+    REQUIRE(std::to_string(apply(proc("second"), Values{values.data(), 2}, *env)) == "b");
+    REQUIRE(std::to_string(apply(proc("list"), Values{values.data(), 3}, *env)) == "(a b (c))");
+    REQUIRE(std::to_string(apply(proc("list"), Values{values.data(), 0}, *env)) == "()");
+    REQUIRE(length(*dynamic_node_cast<List>(apply(proc("copy"), Values{values.data() + 2, 1}, *env))) == 1);
+    REQUIRE_THROWS_AS(apply(proc("second"), Values{values.data(), 3}, *env), EvalError);
+
+    auto const kar = make_native_proc("kar", [](Node const& list) { return car(*dynamic_node_cast<List>(list)); });
+    REQUIRE(std::to_string(apply(kar, Values{values.data() + 2, 1}, *env)) == "c");
+    REQUIRE_THROWS_AS(apply(proc("if-nil"), Values{values.data(), 3}, *env), EvalError);
+}
+
+TEST_CASE("Too deep evaluations raise EvalError", "[eval]")
+{
+    auto mode = GENERATE(EvalMode::recursive, EvalMode::stack, EvalMode::bytecode);
+    EvalSettings settings{mode, 1'000};
+
+    auto env = make_env();
+    env->set("items", make_list(2'000));
+    REQUIRE_THROWS_AS(eval(parse("(copy items)"), *env), EvalError);
+    REQUIRE_THROWS_AS(eval(parse("(copy-native items)"), *env), EvalError);
+
+    // and evaluation works again afterwards
+    env->set("items", make_list(100));
+    REQUIRE(length(*dynamic_node_cast<List>(eval(parse("(copy items)"), *env))) == 100);
+}
+
+TEST_CASE("Recursion on the native stack raises EvalError before it runs out", "[eval]")
+{
+    auto env = make_env();
+    env->set("items", make_list(1'000'000));
+
+    // with the default limit, and with none but the native stack
+    auto max_depth = GENERATE(max_eval_depth(), std::numeric_limits<std::size_t>::max());
+    EvalSettings settings{EvalMode::recursive, max_depth};
+    REQUIRE_THROWS_AS(eval(parse("(copy items)"), *env), EvalError);
+    REQUIRE_THROWS_AS(eval(parse("(copy-native items)"), *env), EvalError);
+}
+
+TEST_CASE("Stack and bytecode eval modes keep lambda recursion off the native stack", "[eval]")
+{
+    auto mode = GENERATE(EvalMode::stack, EvalMode::bytecode);
+    EvalSettings settings{mode, 10'000'000};
+
+    auto env = make_env();
+    env->set("items", make_list(1'000'000));
+    REQUIRE(length(*dynamic_node_cast<List>(eval(parse("(copy items)"), *env))) == 1'000'000);
+    REQUIRE(length(*dynamic_node_cast<List>(eval(parse("(copy-native items)"), *env))) == 1'000'000);
+}
+
+} // namespace mll
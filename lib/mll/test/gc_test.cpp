@@ -0,0 +1,130 @@
+#include <catch2/catch.hpp>
+
+#include <mll/env.hpp>
+#include <mll/gc.hpp>
+#include <mll/lambda.hpp>
+#include <mll/list.hpp>
+#include <mll/proc.hpp>
+#include <mll/symbol.hpp>
+
+#include <vector>
+
+namespace mll {
+
+namespace {
+// a frame that holds a closure over itself
+std::shared_ptr<Env> make_cyclic_frame(Env& base)
+{
+    auto frame = base.derive_new();
+    frame->set("self", make_lambda("self", nil, nil, frame));
+    return frame;
+}
+} // namespace
+
+TEST_CASE("Garbage collector frees closure cycles", "[GarbageCollector]")
+{
+    GarbageCollector::enable(true);
+
+    auto root = Env::create();
+    std::weak_ptr<Env> garbage = make_cyclic_frame(*root);
+    REQUIRE_FALSE(garbage.expired());
+
+    auto stats = GarbageCollector::collect();
+    REQUIRE(garbage.expired());
+    REQUIRE(stats.last_collected_envs == 1);
+    REQUIRE(stats.last_collected_nodes >= 1);
+
+    GarbageCollector::enable(false);
+}
+
+TEST_CASE("Garbage collector keeps reachable envs", "[GarbageCollector]")
+{
+    GarbageCollector::enable(true);
+
+    auto root = Env::create();
+
+    // held from C++
+    auto held = make_cyclic_frame(*root);
+
+    // reachable through a binding of an env held from C++
+    std::weak_ptr<Env> bound = make_cyclic_frame(*root);
+    root->set("bound", *bound.lock()->shallow_lookup("self"));
+
+    GarbageCollector::collect();
+    REQUIRE(held->shallow_lookup("self").has_value());
+    REQUIRE_FALSE(bound.expired());
+    REQUIRE(bound.lock()->shallow_lookup("self").has_value());
+    REQUIRE(root->shallow_lookup("quote").has_value());
+
+    GarbageCollector::enable(false);
+}
+
+TEST_CASE("Garbage collector frees closure cycles through lambda frames", "[GarbageCollector]")
+{
+    GarbageCollector::enable(true);
+
+    auto root = Env::create();
+    auto outer = make_lambda("outer", nil, nil, root);
+    auto frame = outer.core()->lambda()->bind(Values{nullptr, 0});
+    frame->set("self", make_lambda("self", nil, cons(Symbol{"self"}, nil), frame));
+
+    // the closure keeps the frame's twin, not the frame
+    std::weak_ptr<Env> twin = Proc::from_node(*frame->shallow_lookup("self"))->core()->lambda()->outer_env;
+    REQUIRE(twin.lock() != frame);
+    REQUIRE(twin.lock()->shallow_lookup("self").has_value());
+
+    std::weak_ptr<Env> garbage = frame;
+    frame.reset();
+    REQUIRE(garbage.expired());
+    REQUIRE_FALSE(twin.expired());
+
+    GarbageCollector::collect();
+    REQUIRE(twin.expired());
+
+    GarbageCollector::enable(false);
+}
+
+TEST_CASE("Garbage collector frees cycles through lambda frames kept whole", "[GarbageCollector]")
+{
+    GarbageCollector::enable(true);
+
+    auto root = Env::create();
+    auto outer = make_lambda("outer", nil, nil, root);
+    auto frame = outer.core()->lambda()->bind(Values{nullptr, 0});
+
+    // a call to an unbound operator may name any binding of the frame
+    auto body = cons(cons(Symbol{"unbound"}, nil), nil);
+    frame->set("self", make_lambda("self", nil, body, frame));
+    REQUIRE(Proc::from_node(*frame->shallow_lookup("self"))->core()->lambda()->outer_env == frame);
+
+    std::weak_ptr<Env> garbage = frame;
+    frame.reset();
+    REQUIRE_FALSE(garbage.expired());
+
+    GarbageCollector::collect();
+    REQUIRE(garbage.expired());
+
+    GarbageCollector::enable(false);
+}
+
+TEST_CASE("Garbage collector leaves lambda frames no closure keeps untracked", "[GarbageCollector]")
+{
+    GarbageCollector::enable(true);
+
+    auto root = Env::create();
+    auto lambda = make_lambda("f", nil, nil, root);
+    auto const tracked = GarbageCollector::stats().tracked_envs;
+
+    std::vector<std::shared_ptr<Env>> frames;
+    for (int i = 0; i < 100; ++i) {
+        frames.push_back(lambda.core()->lambda()->bind(Values{nullptr, 0}));
+    }
+    REQUIRE(GarbageCollector::stats().tracked_envs == tracked);
+
+    auto derived = frames.back()->derive_new();
+    REQUIRE(GarbageCollector::stats().tracked_envs == tracked + 1);
+
+    GarbageCollector::enable(false);
+}
+
+} // namespace mll
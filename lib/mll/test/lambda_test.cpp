@@ -0,0 +1,137 @@
+#include <catch2/catch.hpp>
+
+#include <mll/analyze.hpp>
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/lambda.hpp>
+#include <mll/list.hpp>
+#include <mll/parser.hpp>
+#include <mll/print.hpp>
+#include <mll/symbol.hpp>
+
+#include <sstream>
+
+namespace mll {
+
+namespace {
+List parse_list(std::string const& text)
+{
+    std::istringstream istream{text};
+    return *dynamic_node_cast<List>(*Parser{}.parse(istream));
+}
+} // namespace
+
+TEST_CASE("Lambda calls in tail position run in constant stack", "[Lambda]")
+{
+    auto env = Env::create();
+    env->set("cdr", Proc{"cdr", [](List const& args, Env& env) {
+                             return cdr(*dynamic_node_cast<List>(eval(car(args), env)));
+                         }});
+    env->set("if-nil", make_tail_proc("if-nil", [](List const& args, Env& env, TailCall& tail) {
+                 auto branch = eval(car(args), env).is_nil() ? cadr(args) : cadr(cdr(args));
+                 tail = TailCall{branch, env.shared_from_this()};
+                 return Node{};
+             }));
+    env->set("loop", make_lambda("loop", parse_list("(l)"), parse_list("((if-nil l 'done (loop (cdr l))))"), env));
+
+    List list;
+    for (int i = 0; i < 1'000'000; ++i) {
+        list = cons(nil, list);
+    }
+    env->set("items", list);
+
+    auto result = dynamic_node_cast<Symbol>(eval(parse_list("(loop items)"), *env));
+    REQUIRE(result.has_value());
+    REQUIRE(result->name() == "done");
+}
+
+TEST_CASE("Lambda bodies run analyzed code", "[Lambda]")
+{
+    auto env = Env::create();
+    auto analyzed = 0;
+    auto called = 0;
+    env->set("one", make_tail_proc(
+                        "one",
+                        [&called](List const& /*args*/, Env& /*env*/, TailCall& /*tail*/) {
+                            ++called;
+                            return Node{Symbol{"one"}};
+                        },
+                        [&analyzed](List const& /*args*/, std::shared_ptr<Scope const> const& /*scope*/) {
+                            ++analyzed;
+                            return make_constant(Symbol{"one"});
+                        }));
+    env->set("first", make_applicative_proc("first", [](List const& values, Env& /*env*/) { return car(values); }));
+    env->set("f", make_lambda("f", parse_list("(x)"), parse_list("((first (one) x))"), env));
+
+    for (int i = 0; i < 3; ++i) {
+        auto result = dynamic_node_cast<Symbol>(eval(parse_list("(f 'a)"), *env));
+        REQUIRE(result.has_value());
+        REQUIRE(result->name() == "one");
+    }
+    REQUIRE(analyzed == 1);
+    REQUIRE(called == 0);
+
+    // rebinding the operator takes effect at the analyzed call site
+    env->set("one", Proc{"one", [](List const& /*args*/, Env& /*env*/) { return Node{Symbol{"uno"}}; }});
+    auto result = dynamic_node_cast<Symbol>(eval(parse_list("(f 'a)"), *env));
+    REQUIRE(result.has_value());
+    REQUIRE(result->name() == "uno");
+}
+
+TEST_CASE("Analyzed call sites keep to the operator they were last bound to", "[Lambda]")
+{
+    auto env = Env::create();
+    auto analyzed = 0;
+    auto make_one = [&analyzed](char const* name) {
+        return make_tail_proc(
+            "one", [](List const& /*args*/, Env& /*env*/, TailCall& /*tail*/) { return Node{}; },
+            [&analyzed, name](List const& /*args*/, std::shared_ptr<Scope const> const& /*scope*/) {
+                ++analyzed;
+                return make_constant(Symbol{name});
+            });
+    };
+    env->set("one", make_one("one"));
+    env->set("f", make_lambda("f", parse_list("()"), parse_list("((one))"), env));
+
+    auto call = [&env] { return std::to_string(eval(parse_list("(f)"), *env)); };
+    REQUIRE(call() == "one");
+    REQUIRE(analyzed == 1);
+
+    env->set("one", make_one("uno"));
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(call() == "uno");
+    }
+    REQUIRE(analyzed == 2);
+}
+
+TEST_CASE("Calls to special forms by name respect shadowing", "[Lambda]")
+{
+    auto env = Env::create();
+    env->set("kwote", make_special_form("kwote", SpecialForm::quote,
+                                        [](List const& args, Env& /*env*/, TailCall& /*tail*/) { return car(args); }));
+    env->set("car", make_applicative_proc("car", [](List const& values, Env& /*env*/) {
+                 return car(*dynamic_node_cast<List>(car(values)));
+             }));
+    // binds kwote to car in the calling frame if its argument is not nil
+    env->set("shadow-if", Proc{"shadow-if", [](List const& args, Env& env) {
+                                   if (!eval(car(args), env).is_nil()) {
+                                       env.set("kwote", *env.deep_lookup("car"));
+                                   }
+                                   return Node{};
+                               }});
+    env->set("f", make_lambda("f", parse_list("(x shadow)"), parse_list("((shadow-if shadow) (kwote x))"), env));
+    env->set("g", make_lambda("g", parse_list("(kwote x)"), parse_list("((kwote x))"), env));
+
+    auto call = [&env](std::string const& text) { return std::to_string(eval(parse_list(text), *env)); };
+    REQUIRE(call("(f '(a b) '())") == "x");
+    REQUIRE(call("(f '(a b) '())") == "x");
+
+    // a definition in a frame on the way
+    REQUIRE(call("(f '(a b) 't)") == "a");
+    REQUIRE(call("(f '(a b) '())") == "x");
+
+    // a lambda argument of the same name
+    REQUIRE(call("(g car '(a b))") == "a");
+}
+
+} // namespace mll
@@ -1,7 +1,10 @@
 #include <catch2/catch.hpp>
 
+#include <mll/alloc.hpp>
 #include <mll/list.hpp>
 
+#include <thread>
+
 namespace mll {
 
 TEST_CASE("List is nil by default", "[List]")
@@ -28,4 +31,32 @@ TEST_CASE("List can be casted from Node", "[List]")
         REQUIRE(dynamic_node_cast<List>(node)->empty());
     }
 }
-} // namespace mll
\ No newline at end of file
+
+TEST_CASE("Long lists are freed without recursion", "[List]")
+{
+    List list;
+    for (int i = 0; i < 10'000'000; ++i) {
+        list = cons(nil, list);
+    }
+    auto shared_tail = cdr(cdr(list));
+
+    list = nil;
+    REQUIRE(shared_tail.core()->use_count() == 1);
+
+    shared_tail = nil;
+    REQUIRE(shared_tail.empty());
+}
+
+TEST_CASE("Long lists from a region are freed without recursion on another thread", "[List]")
+{
+    List list;
+    {
+        AllocationRegion region;
+        for (int i = 0; i < 50'000; ++i) {
+            list = cons(nil, list);
+        }
+    }
+    // threads other than the main one may have much smaller stacks
+    std::thread{[list = std::move(list)]() mutable { list = nil; }}.join();
+}
+} // namespace mll
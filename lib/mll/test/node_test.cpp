@@ -15,4 +15,27 @@ TEST_CASE("Node is nil by default", "[Node]")
     REQUIRE(node.core() == nullptr);
 }
 
-} // namespace mll
\ No newline at end of file
+TEST_CASE("Node copies share one reference counted core", "[Node]")
+{
+    List list{Symbol{"a"}, nil};
+    auto core = list.core().get();
+    REQUIRE(core->use_count() == 1);
+
+    {
+        Node node{list};
+        Node copy{node};
+        REQUIRE(copy.core() == core);
+        REQUIRE(core->use_count() == 3);
+
+        Node moved{std::move(copy)};
+        REQUIRE(copy.is_nil());
+        REQUIRE(core->use_count() == 3);
+
+        node = Node{};
+        REQUIRE(core->use_count() == 2);
+    }
+
+    REQUIRE(core->use_count() == 1);
+}
+
+} // namespace mll
@@ -1,6 +1,10 @@
 #include <catch2/catch.hpp>
 
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/list.hpp>
 #include <mll/proc.hpp>
+#include <mll/symbol.hpp>
 
 namespace mll {
 
@@ -11,4 +15,80 @@ TEST_CASE("Proc can be casted from Node", "[Proc]")
     REQUIRE(dynamic_node_cast<Proc>(node).has_value());
 }
 
-} // namespace mll
\ No newline at end of file
+TEST_CASE("Applicative procs are called with the values of their arguments", "[Proc]")
+{
+    auto env = Env::create();
+    env->set("x", Symbol{"value"});
+    auto proc = make_applicative_proc("id", [](List const& values, Env& /*env*/) { return car(values); });
+
+    auto result = dynamic_node_cast<Symbol>(proc.call(cons(Symbol{"x"}, nil), *env));
+    REQUIRE(result.has_value());
+    REQUIRE(result->name() == "value");
+}
+
+TEST_CASE("Native procs are passed the values of their arguments in place", "[Proc]")
+{
+    auto env = Env::create();
+    env->set("x", Symbol{"value"});
+
+    SECTION("one per argument, checking their number")
+    {
+        auto proc = make_native_proc("second", [](Node const& /*first*/, Node const& second) { return second; });
+        REQUIRE(proc.core()->applicative());
+
+        auto result = dynamic_node_cast<Symbol>(proc.call(cons(nil, cons(Symbol{"x"}, nil)), *env));
+        REQUIRE(result.has_value());
+        REQUIRE(result->name() == "value");
+
+        // called through apply(), the values are not evaluated again
+        result = dynamic_node_cast<Symbol>(proc.core()->apply(cons(nil, cons(Symbol{"x"}, nil)), *env));
+        REQUIRE(result.has_value());
+        REQUIRE(result->name() == "x");
+
+        REQUIRE_THROWS_AS(proc.call(cons(Symbol{"x"}, nil), *env), EvalError);
+        REQUIRE_THROWS_AS(proc.core()->apply(cons(nil, cons(nil, cons(nil, nil))), *env), EvalError);
+    }
+
+    SECTION("all at once")
+    {
+        auto proc = make_native_proc("first", [](Values values) { return values.empty() ? nil : values[0]; });
+
+        REQUIRE(proc.call(nil, *env).is_nil());
+
+        auto result = dynamic_node_cast<Symbol>(proc.call(cons(Symbol{"x"}, cons(nil, nil)), *env));
+        REQUIRE(result.has_value());
+        REQUIRE(result->name() == "value");
+    }
+
+    SECTION("with the env of the call")
+    {
+        auto proc = make_native_proc("env", [](Env& call_env) { return *call_env.lookup(Symbol{"x"}); });
+
+        auto result = dynamic_node_cast<Symbol>(proc.call(nil, *env->derive_new()));
+        REQUIRE(result.has_value());
+        REQUIRE(result->name() == "value");
+    }
+}
+
+TEST_CASE("Names bound only to one special form are recognized by name", "[Proc]")
+{
+    auto const quote_like = [](std::string name) {
+        return make_special_form(std::move(name), SpecialForm::quote,
+                                 [](List const& args, Env& /*env*/, TailCall& /*tail*/) { return car(args); });
+    };
+    Symbol const name{"proc-test-quote"};
+    REQUIRE(bound_special_form(name) == SpecialForm::none);
+
+    auto env = Env::create();
+    env->set(name, quote_like("a"));
+    Env::create()->set(name, quote_like("b"));
+    REQUIRE(bound_special_form(name) == SpecialForm::quote);
+
+    // shadowing it anywhere, even in a frame of its own, loses it for good
+    env->derive_new()->set(name, nil);
+    REQUIRE(bound_special_form(name) == SpecialForm::none);
+    env->set(name, quote_like("c"));
+    REQUIRE(bound_special_form(name) == SpecialForm::none);
+}
+
+} // namespace mll
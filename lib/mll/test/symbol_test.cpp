@@ -2,6 +2,10 @@
 
 #include <mll/symbol.hpp>
 
+#include <set>
+#include <thread>
+#include <vector>
+
 namespace mll {
 
 TEST_CASE("Same name results same symbol", "[Symbol]")
@@ -12,6 +16,68 @@ TEST_CASE("Same name results same symbol", "[Symbol]")
     REQUIRE(sym1.core() == sym2.core());
 }
 
+TEST_CASE("Symbols carry dense ids", "[Symbol]")
+{
+    Symbol sym1{"id-test-1"};
+    Symbol sym2{"id-test-2"};
+    std::string_view name{"id-test-1 and more"};
+
+    REQUIRE(sym2.id() == sym1.id() + 1);
+    REQUIRE(Symbol{name.substr(0, 9)}.id() == sym1.id());
+}
+
+TEST_CASE("Symbol::find does not intern", "[Symbol]")
+{
+    REQUIRE_FALSE(Symbol::find("find-test").has_value());
+
+    Symbol sym{"find-test"};
+    REQUIRE(Symbol::find("find-test")->core() == sym.core());
+}
+
+TEST_CASE("Symbols survive symbol table growth", "[Symbol]")
+{
+    std::vector<Symbol> symbols;
+    for (int i = 0; i < 1000; ++i) {
+        symbols.emplace_back("grow-test-" + std::to_string(i));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE(Symbol{"grow-test-" + std::to_string(i)}.core() == symbols[i].core());
+    }
+}
+
+TEST_CASE("Symbols are interned process-wide", "[Symbol]")
+{
+    constexpr int thread_count = 8;
+    constexpr int name_count = 5000;
+
+    // every thread interns the same names, each starting at a different offset
+    std::vector<std::vector<Symbol::Core const*>> cores(thread_count);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t) {
+        threads.emplace_back([t, &cores] {
+            cores[t].resize(name_count);
+            for (int i = 0; i < name_count; ++i) {
+                auto const n = (i + t * name_count / thread_count) % name_count;
+                cores[t][n] = Symbol{"mt-test-" + std::to_string(n)}.core();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::set<std::uint32_t> ids;
+    for (int i = 0; i < name_count; ++i) {
+        for (int t = 1; t < thread_count; ++t) {
+            REQUIRE(cores[t][i] == cores[0][i]);
+        }
+        REQUIRE(Symbol{"mt-test-" + std::to_string(i)}.core() == cores[0][i]);
+        ids.insert(cores[0][i]->id);
+    }
+    REQUIRE(ids.size() == name_count);
+    REQUIRE(*ids.rbegin() - *ids.begin() == name_count - 1);
+}
+
 TEST_CASE("Symbol can be casted from Node", "[Symbol]")
 {
     Symbol symbol{"x"};
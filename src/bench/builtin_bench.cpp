@@ -0,0 +1,120 @@
+#include "number.hpp"
+#include "operators.hpp"
+#include "parser.hpp"
+#include "primitives.hpp"
+#include "string.hpp"
+
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/list.hpp>
+#include <mll/node.hpp>
+#include <mll/proc.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <sstream>
+
+namespace {
+
+std::shared_ptr<mll::Env> make_env()
+{
+    auto env = mll::Env::create();
+    mlisp::set_primitive_procs(*env);
+    mlisp::set_complementary_procs(*env);
+    mlisp::set_number_procs(*env);
+    mlisp::set_string_procs(*env);
+    mlisp::set_symbol_procs(*env);
+    return env;
+}
+
+mll::Node eval_text(char const* text, mll::Env& env)
+{
+    std::istringstream iss{text};
+    mlisp::Parser parser;
+    mll::Node result;
+    while (auto expr = parser.parse(iss)) {
+        result = mll::eval(*expr, env);
+    }
+    return result;
+}
+
+struct EvalModeSetting {
+    explicit EvalModeSetting(mll::EvalMode mode)
+    {
+        mll::set_eval_mode(mode);
+    }
+
+    ~EvalModeSetting()
+    {
+        mll::set_eval_mode(old_mode);
+    }
+
+    mll::EvalMode const old_mode = mll::eval_mode();
+};
+
+} // namespace
+
+TEST_CASE("Builtin call overhead", "[builtin]")
+{
+    auto env = make_env();
+    auto const cons = *mll::Proc::from_node(*env->lookup(mll::Symbol{"cons"}));
+    auto const add = *mll::Proc::from_node(*env->lookup(mll::Symbol{"+"}));
+    std::array<mll::Node, 2> const values{mlisp::Number{1}, mll::nil};
+    std::array<mll::Node, 2> const numbers{mlisp::Number{1}, mlisp::Number{2}};
+
+    BENCHMARK("cons, values in a list")
+    {
+        return cons.core()->apply(mll::cons(values[0], mll::cons(values[1], mll::nil)), *env);
+    };
+
+    BENCHMARK("cons, values in place")
+    {
+        return cons.core()->apply_values(mll::Values{values.data(), values.size()}, *env);
+    };
+
+    BENCHMARK("+, values in a list")
+    {
+        return add.core()->apply(mll::cons(numbers[0], mll::cons(numbers[1], mll::nil)), *env);
+    };
+
+    BENCHMARK("+, values in place")
+    {
+        return add.core()->apply_values(mll::Values{numbers.data(), numbers.size()}, *env);
+    };
+
+    eval_text("(define count (lambda (n)"
+              "  (cond ((number-less? n 1) n)"
+              "        ('t (count (- (+ n (car (cons 1 '()))) 2))))))",
+              *env);
+
+    // 5 builtin calls per iteration
+    BENCHMARK("count 1000 (5000 builtin calls)")
+    {
+        return eval_text("(count 1000)", *env);
+    };
+
+    EvalModeSetting setting{mll::EvalMode::bytecode};
+
+    BENCHMARK("count 1000 (5000 builtin calls), bytecode eval mode")
+    {
+        return eval_text("(count 1000)", *env);
+    };
+}
+
+TEST_CASE("Evaluation contexts", "[builtin]")
+{
+    auto const builtins = make_env()->freeze();
+
+    BENCHMARK("new env with the builtins set up")
+    {
+        auto env = make_env();
+        return eval_text("(define x (cons 1 '())) (car x)", *env);
+    };
+
+    BENCHMARK("fork of a frozen env with the builtins")
+    {
+        auto env = builtins->fork();
+        return eval_text("(define x (cons 1 '())) (car x)", *env);
+    };
+}
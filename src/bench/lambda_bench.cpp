@@ -0,0 +1,206 @@
+#include "number.hpp"
+#include "operators.hpp"
+#include "parser.hpp"
+#include "primitives.hpp"
+#include "string.hpp"
+
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/list.hpp>
+#include <mll/node.hpp>
+#include <mll/proc.hpp>
+#include <mll/symbol.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <sstream>
+
+namespace {
+
+std::shared_ptr<mll::Env> make_env()
+{
+    auto env = mll::Env::create();
+    mlisp::set_primitive_procs(*env);
+    mlisp::set_complementary_procs(*env);
+    mlisp::set_number_procs(*env);
+    mlisp::set_string_procs(*env);
+    mlisp::set_symbol_procs(*env);
+    return env;
+}
+
+mll::Node eval_text(char const* text, mll::Env& env)
+{
+    std::istringstream iss{text};
+    mlisp::Parser parser;
+    mll::Node result;
+    while (auto expr = parser.parse(iss)) {
+        result = mll::eval(*expr, env);
+    }
+    return result;
+}
+
+struct EvalModeSetting {
+    explicit EvalModeSetting(mll::EvalMode mode)
+    {
+        mll::set_eval_mode(mode);
+    }
+
+    ~EvalModeSetting()
+    {
+        mll::set_eval_mode(old_mode);
+    }
+
+    mll::EvalMode const old_mode = mll::eval_mode();
+};
+
+} // namespace
+
+TEST_CASE("Lambda call throughput", "[lambda]")
+{
+    auto env = make_env();
+    eval_text("(define fib (lambda (n)"
+              "  (cond ((number-less? n 2) n)"
+              "        ('t (+ (fib (- n 1)) (fib (- n 2)))))))",
+              *env);
+
+    // fib(n) makes fib(n + 1) * 2 - 1 calls
+    BENCHMARK("fib 15 (1973 calls)")
+    {
+        return eval_text("(fib 15)", *env);
+    };
+
+    BENCHMARK("fib 20 (21891 calls)")
+    {
+        return eval_text("(fib 20)", *env);
+    };
+
+    EvalModeSetting setting{mll::EvalMode::stack};
+
+    BENCHMARK("fib 15 (1973 calls), stack eval mode")
+    {
+        return eval_text("(fib 15)", *env);
+    };
+
+    BENCHMARK("fib 20 (21891 calls), stack eval mode")
+    {
+        return eval_text("(fib 20)", *env);
+    };
+}
+
+TEST_CASE("Global reads from nested lambdas", "[lambda]")
+{
+    auto env = make_env();
+    eval_text("(define limit 1000)"
+              "(define nested (lambda (a) (lambda (b) (lambda (c)"
+              "  (lambda (n) (cond ((number-less? n limit) (count-up (+ n 1))) ('t n)))))))"
+              "(define count-up (((nested 1) 2) 3))",
+              *env);
+
+    // limit, number-less?, count-up and + are globals read four frames deep
+    BENCHMARK("count-up 0")
+    {
+        return eval_text("(count-up 0)", *env);
+    };
+
+    EvalModeSetting setting{mll::EvalMode::stack};
+
+    BENCHMARK("count-up 0, stack eval mode")
+    {
+        return eval_text("(count-up 0)", *env);
+    };
+}
+
+TEST_CASE("Lambda-only recursion", "[lambda]")
+{
+    auto env = make_env();
+    eval_text("(define kons (lambda (a b) (cons a b)))"
+              "(define build (lambda (n)"
+              "  (cond ((eq n 0) '())"
+              "        ('t (kons n (build (- n 1)))))))",
+              *env);
+
+    BENCHMARK("build 2000")
+    {
+        return eval_text("(build 2000)", *env);
+    };
+
+    EvalModeSetting setting{mll::EvalMode::stack};
+
+    BENCHMARK("build 2000, stack eval mode")
+    {
+        return eval_text("(build 2000)", *env);
+    };
+}
+
+TEST_CASE("Loops built on macros", "[lambda]")
+{
+    auto env = make_env();
+    eval_text("(define my-if (macro (p a b) `(cond (,p ,a) ('t ,b))))"
+              "(define count-down (lambda (n)"
+              "  (my-if (number-equal? n 0) 'done (count-down (- n 1)))))"
+              "(define count-down-cond (lambda (n)"
+              "  (cond ((number-equal? n 0) 'done) ('t (count-down-cond (- n 1))))))",
+              *env);
+
+    BENCHMARK("count-down 2000, through a macro")
+    {
+        return eval_text("(count-down 2000)", *env);
+    };
+
+    BENCHMARK("count-down 2000, hand-written")
+    {
+        return eval_text("(count-down-cond 2000)", *env);
+    };
+}
+
+TEST_CASE("Host-to-Lisp round trip", "[lambda]")
+{
+    auto env = make_env();
+    eval_text("(define handler (lambda (kind n) (cond ((eq kind 'add) (+ n 1)) ('t n))))", *env);
+    auto const handler = *mll::Proc::from_node(*env->lookup(mll::Symbol{"handler"}));
+    auto const quote = mll::Symbol{"quote"};
+    std::array<mll::Node, 2> const values{mll::Symbol{"add"}, mlisp::Number{41}};
+
+    BENCHMARK("eval of a call built from quoted values")
+    {
+        auto const quoted = [&quote](mll::Node const& value) { return mll::cons(quote, mll::cons(value, mll::nil)); };
+        auto const call = mll::cons(handler, mll::cons(quoted(values[0]), mll::cons(quoted(values[1]), mll::nil)));
+        return mll::eval(call, *env);
+    };
+
+    BENCHMARK("apply to the values")
+    {
+        return mll::apply(handler, mll::Values{values.data(), values.size()}, *env);
+    };
+
+    EvalModeSetting setting{mll::EvalMode::bytecode};
+
+    BENCHMARK("apply to the values, bytecode eval mode")
+    {
+        return mll::apply(handler, mll::Values{values.data(), values.size()}, *env);
+    };
+}
+
+TEST_CASE("Closures made in lambda frames", "[lambda]")
+{
+    auto env = make_env();
+    eval_text("(define adder (lambda (items n) (lambda (x) (+ x n))))"
+              "(define sum-adders (lambda (k acc)"
+              "  (cond ((number-equal? k 0) acc)"
+              "        ('t (sum-adders (- k 1) ((adder '(1 2 3) k) acc))))))",
+              *env);
+
+    // each closure keeps only `n` of the frame it is made in
+    BENCHMARK("sum-adders 1000")
+    {
+        return eval_text("(sum-adders 1000 0)", *env);
+    };
+
+    EvalModeSetting setting{mll::EvalMode::bytecode};
+
+    BENCHMARK("sum-adders 1000, bytecode eval mode")
+    {
+        return eval_text("(sum-adders 1000 0)", *env);
+    };
+}
@@ -2,6 +2,7 @@
 
 #include <mll/eval.hpp>
 #include <mll/list.hpp>
+#include <mll/proc.hpp>
 
 #include <string>
 
@@ -16,12 +17,23 @@ void assert_argc(mll::List const& args, size_t count, char const* cmd)
     }
 }
 
-void assert_argc_min(mll::List const& args, size_t min, char const* cmd)
+namespace {
+void assert_count_min(size_t count, size_t min, char const* cmd)
 {
-    auto len = mll::length(args);
-    if (len < min) {
+    if (count < min) {
         throw mll::EvalError(cmd + " expects "s + std::to_string(min) + " or more arguments.");
     }
 }
+} // namespace
+
+void assert_argc_min(mll::List const& args, size_t min, char const* cmd)
+{
+    assert_count_min(mll::length(args), min, cmd);
+}
+
+void assert_argc_min(mll::Values const& values, size_t min, char const* cmd)
+{
+    assert_count_min(values.size(), min, cmd);
+}
 
 } // namespace mlisp
\ No newline at end of file
@@ -2,9 +2,11 @@
 
 namespace mll {
 class List;
+class Values;
 }
 
 namespace mlisp {
 void assert_argc(mll::List const& args, size_t count, char const* cmd);
 void assert_argc_min(mll::List const& args, size_t min, char const* cmd);
+void assert_argc_min(mll::Values const& values, size_t min, char const* cmd);
 } // namespace mlisp
\ No newline at end of file
@@ -1,3 +1,6 @@
+#pragma once
+
+#include <mll/bind.hpp>
 #include <mll/list.hpp>
 #include <mll/symbol.hpp>
 
@@ -14,4 +17,18 @@ inline bool to_bool(mll::Node const& node)
     return !list || !list->empty();
 }
 
-} // namespace mlisp
\ No newline at end of file
+} // namespace mlisp
+
+// Anything but nil is true, as in cond.
+template <>
+struct mll::NodeConversion<bool> {
+    static constexpr char const* expected = "a bool";
+    static std::optional<bool> from_node(Node const& node)
+    {
+        return mlisp::to_bool(node);
+    }
+    static Node to_node(bool value)
+    {
+        return mlisp::to_node(value);
+    }
+};
\ No newline at end of file
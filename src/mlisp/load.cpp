@@ -1,13 +1,16 @@
 #include "load.hpp"
 
 #include "parser.hpp"
+#include "primitives.hpp"
 #include "string.hpp"
 
 #include <mll/env.hpp>
 #include <mll/eval.hpp>
+#include <mll/gc.hpp>
 #include <mll/node.hpp>
 #include <mll/print.hpp>
 
+#include <atomic>
 #include <cassert>
 #include <fstream>
 #include <iostream>
@@ -20,6 +23,8 @@ namespace {
 
 auto constexpr LOAD_PATH_KEY = "mlisp:load-path";
 
+std::atomic<bool> expand_on_load{false};
+
 std::string get_current_load_path(mll::Env const& env)
 {
     std::string load_path;
@@ -78,7 +83,11 @@ bool load_file(mll::Env& env, std::string const& filepath)
                 if (!expr.has_value()) {
                     break;
                 }
+                if (macroexpand_on_load()) {
+                    expr = macroexpand_all(*expr, env);
+                }
                 eval(*expr, env);
+                mll::GarbageCollector::collect_if_needed();
             }
         }
         catch (mll::ParseError& e) {
@@ -95,4 +104,14 @@ bool load_file(mll::Env& env, std::string const& filepath)
     return false;
 }
 
+void set_macroexpand_on_load(bool enable)
+{
+    expand_on_load.store(enable, std::memory_order_relaxed);
+}
+
+bool macroexpand_on_load()
+{
+    return expand_on_load.load(std::memory_order_relaxed);
+}
+
 } // namespace mlisp
\ No newline at end of file
@@ -10,4 +10,10 @@ namespace mlisp {
 
 bool load_file(mll::Env& env, std::string const& filepath);
 
+// Whether load_file expands the macro calls throughout each top-level form
+// (see macroexpand_all) before evaluating it, so that the code it defines has
+// none left to expand when it runs. Off by default.
+void set_macroexpand_on_load(bool enable);
+bool macroexpand_on_load();
+
 } // namespace mlisp
@@ -1,6 +1,7 @@
 
 #include <mll/env.hpp>
 #include <mll/eval.hpp>
+#include <mll/gc.hpp>
 #include <mll/print.hpp>
 
 #include "load.hpp"
@@ -11,7 +12,12 @@
 #include "repl.hpp"
 #include "string.hpp"
 
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #if __has_include(<unistd.h>)
 #include <unistd.h> // isatty
@@ -20,8 +26,68 @@
 #define MLISP_EVAL_PIPED_STDIN 0
 #endif
 
+namespace {
+// Handles `--eval=recursive|stack|bytecode`, `--max-eval-depth=N`,
+// `--macroexpand` (see set_macroexpand_on_load) and `--lookup-stats`, which
+// reports the global lookup cache hits and misses on exit; returns false for
+// anything else.
+bool set_eval_option(char const* arg)
+{
+    if (std::strcmp(arg, "--lookup-stats") == 0) {
+        std::atexit([] {
+            auto const stats = mll::LookupCache::stats();
+            std::cerr << "lookup cache: " << stats.hits << " hits, " << stats.misses << " misses\n";
+        });
+        return true;
+    }
+    if (std::strcmp(arg, "--macroexpand") == 0) {
+        mlisp::set_macroexpand_on_load(true);
+        return true;
+    }
+    if (std::strcmp(arg, "--eval=recursive") == 0) {
+        mll::set_eval_mode(mll::EvalMode::recursive);
+        return true;
+    }
+    if (std::strcmp(arg, "--eval=stack") == 0) {
+        mll::set_eval_mode(mll::EvalMode::stack);
+        return true;
+    }
+    if (std::strcmp(arg, "--eval=bytecode") == 0) {
+        mll::set_eval_mode(mll::EvalMode::bytecode);
+        return true;
+    }
+    auto constexpr MAX_DEPTH = "--max-eval-depth=";
+    if (std::strncmp(arg, MAX_DEPTH, std::strlen(MAX_DEPTH)) == 0) {
+        // only digits, which leaves out negative numbers
+        auto const first = arg + std::strlen(MAX_DEPTH);
+        auto const last = first + std::strlen(first);
+        std::size_t depth = 0;
+        auto const [end, error] = std::from_chars(first, last, depth);
+        if (first == last || end != last || error != std::errc{}) {
+            return false;
+        }
+        mll::set_max_eval_depth(depth);
+        return true;
+    }
+    return false;
+}
+} // namespace
+
 int main(int argc, char* argv[])
 {
+    std::vector<char const*> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--", 2) != 0) {
+            files.push_back(argv[i]);
+        }
+        else if (!set_eval_option(argv[i])) {
+            std::cerr << "Unknown option: " << argv[i] << '\n';
+            return -1;
+        }
+    }
+
+    mll::GarbageCollector::enable(true);
+
     auto env = mll::Env::create();
 
     mlisp::set_primitive_procs(*env);
@@ -31,8 +97,8 @@ int main(int argc, char* argv[])
     mlisp::set_string_procs(*env);
     mlisp::set_symbol_procs(*env);
 
-    for (int i = 1; i < argc; ++i) {
-        if (!mlisp::load_file(*env, argv[i])) {
+    for (auto file : files) {
+        if (!mlisp::load_file(*env, file)) {
             return -1;
         }
     }
@@ -49,6 +115,7 @@ int main(int argc, char* argv[])
                 }
                 mll::print(std::cout, mll::eval(*expr, *env));
                 std::cout << '\n';
+                mll::GarbageCollector::collect_if_needed();
             }
             return parser.clean() ? 0 : -1;
         }
@@ -63,7 +130,7 @@ int main(int argc, char* argv[])
     }
 #endif
 
-    if (argc > 1) {
+    if (!files.empty()) {
         return 0;
     }
 
@@ -13,10 +13,19 @@
 #include <iomanip>
 #include <sstream>
 
-#define MLISP_DEFUN(cmd__, func__)                                                                                     \
+// Defines a proc that is passed the values of its arguments in place (see
+// mll::make_native_proc)
+#define MLISP_DEFUN_NATIVE(cmd__, func__)                                                                              \
     do {                                                                                                               \
         auto const cmd = cmd__;                                                                                        \
-        env.set(cmd, Proc{cmd, func__});                                                                               \
+        env.set(cmd, make_native_proc(cmd, func__));                                                                   \
+    } while (0)
+
+// Defines a proc of `func__`, called as a `signature__` (see mll::bind)
+#define MLISP_DEFUN_BOUND(cmd__, signature__, func__)                                                                  \
+    do {                                                                                                               \
+        auto const cmd = cmd__;                                                                                        \
+        env.set(cmd, bind<signature__>(cmd, func__));                                                                  \
     } while (0)
 
 namespace mlisp {
@@ -63,68 +72,51 @@ void set_number_procs(mll::Env& env)
 {
     using namespace mll;
 
-    MLISP_DEFUN("number?", [cmd](List args, Env& env) {
-        assert_argc(args, 1, cmd);
-        return to_node(is_number(eval(car(args), env)));
-    });
-
-    MLISP_DEFUN("number-equal?", [cmd](List args, Env& env) {
-        assert_argc(args, 2, cmd);
+    MLISP_DEFUN_BOUND("number?", bool(Node const&), is_number);
 
-        auto num1 = to_number_or_throw(eval(car(args), env), cmd);
-        auto num2 = to_number_or_throw(eval(cadr(args), env), cmd);
+    MLISP_DEFUN_BOUND("number-equal?", bool(double, double), [](double lhs, double rhs) { return lhs == rhs; });
 
-        return to_node(num1.value() == num2.value());
-    });
-
-    MLISP_DEFUN("number-less?", [cmd](List args, Env& env) {
-        assert_argc(args, 2, cmd);
-
-        auto num1 = to_number_or_throw(eval(car(args), env), cmd);
-        auto num2 = to_number_or_throw(eval(cadr(args), env), cmd);
-        return to_node(num1.value() < num2.value());
-    });
+    MLISP_DEFUN_BOUND("number-less?", bool(double, double), [](double lhs, double rhs) { return lhs < rhs; });
 
-    MLISP_DEFUN("+", [cmd](List args, Env& env) {
+    MLISP_DEFUN_NATIVE("+", [cmd](Values values) {
         auto result = 0.0;
-        for_each(args,
-                 [&result, &env, cmd](auto const& arg) { result += to_number_or_throw(eval(arg, env), cmd).value(); });
+        for (auto const& value : values) {
+            result += to_number_or_throw(value, cmd).value();
+        }
         return Number{result};
     });
 
-    MLISP_DEFUN("-", [cmd](List args, Env& env) {
-        assert_argc_min(args, 1, cmd);
+    MLISP_DEFUN_NATIVE("-", [cmd](Values values) {
+        assert_argc_min(values, 1, cmd);
 
-        auto result = to_number_or_throw(eval(car(args), env), cmd).value();
-        args = cdr(args);
-        if (args.empty()) {
+        auto result = to_number_or_throw(values[0], cmd).value();
+        if (values.size() == 1) {
             // unary minus
             result = -result;
         }
         else {
-            for_each(args, [&result, &env, cmd](auto const& arg) {
-                result -= to_number_or_throw(eval(arg, env), cmd).value();
-            });
+            for (size_t i = 1; i < values.size(); ++i) {
+                result -= to_number_or_throw(values[i], cmd).value();
+            }
         }
         return Number{result};
     });
 
-    MLISP_DEFUN("*", [cmd](List args, Env& env) {
+    MLISP_DEFUN_NATIVE("*", [cmd](Values values) {
         auto result = 1.0;
-        while (!args.empty()) {
-            auto arg = eval(car(args), env);
-            result *= to_number_or_throw(arg, cmd).value();
-            args = cdr(args);
+        for (auto const& value : values) {
+            result *= to_number_or_throw(value, cmd).value();
         }
         return Number{result};
     });
 
-    MLISP_DEFUN("/", [cmd](List args, Env& env) {
-        assert_argc_min(args, 2, cmd);
+    MLISP_DEFUN_NATIVE("/", [cmd](Values values) {
+        assert_argc_min(values, 2, cmd);
 
-        auto result = to_number_or_throw(eval(car(args), env), cmd).value();
-        for_each(cdr(args),
-                 [&result, &env, cmd](auto const& arg) { result /= to_number_or_throw(eval(arg, env), cmd).value(); });
+        auto result = to_number_or_throw(values[0], cmd).value();
+        for (size_t i = 1; i < values.size(); ++i) {
+            result /= to_number_or_throw(values[i], cmd).value();
+        }
         return Number{result};
     });
 }
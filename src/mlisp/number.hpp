@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mll/bind.hpp>
 #include <mll/custom.hpp>
 
 namespace mll {
@@ -16,4 +17,20 @@ using Number = mll::CustomType<double, NumberPrinter>;
 
 void set_number_procs(mll::Env& env);
 
-} // namespace mlisp
\ No newline at end of file
+} // namespace mlisp
+
+template <>
+struct mll::NodeConversion<double> {
+    static constexpr char const* expected = "a number";
+    static std::optional<double> from_node(Node const& node)
+    {
+        if (auto num = mlisp::Number::from_node(node)) {
+            return num->value();
+        }
+        return std::nullopt;
+    }
+    static Node to_node(double value)
+    {
+        return mlisp::Number{value};
+    }
+};
\ No newline at end of file
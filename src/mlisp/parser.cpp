@@ -29,15 +29,14 @@ namespace mlisp {
 
 Parser::Parser()
 {
-    set_custom_data_func([](std::string const& token, bool is_quoted) {
-        std::shared_ptr<mll::Custom::Core> core;
+    set_custom_data_func([](std::string const& token, bool is_quoted) -> std::optional<mll::Custom> {
         if (is_quoted) {
-            core = std::make_shared<String::Core>(token);
+            return String{token};
         }
-        else if (double value; parse_number(token, &value)) {
-            core = std::make_shared<Number::Core>(value);
+        if (double value; parse_number(token, &value)) {
+            return Number{value};
         }
-        return core;
+        return std::nullopt;
     });
 }
 
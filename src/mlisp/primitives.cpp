@@ -1,21 +1,28 @@
 #include "primitives.hpp"
 
+#include <mll/analyze.hpp>
 #include <mll/env.hpp>
 #include <mll/eval.hpp>
+#include <mll/lambda.hpp>
 #include <mll/list.hpp>
 #include <mll/print.hpp>
 #include <mll/proc.hpp>
 #include <mll/symbol.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <unordered_map>
+#include <vector>
 
 #include "argc.hpp"
 #include "bool.hpp"
 
-#define MLISP_DEFUN(cmd__, func__)                                                                                     \
+// Defines a proc that is passed the values of its arguments in place (see
+// mll::make_native_proc)
+#define MLISP_DEFUN_NATIVE(cmd__, func__)                                                                              \
     do {                                                                                                               \
         auto const cmd = cmd__;                                                                                        \
-        env.set(cmd, Proc{cmd, func__});                                                                               \
+        env.set(cmd, make_native_proc(cmd, func__));                                                                   \
     } while (0)
 
 using namespace mll;
@@ -42,11 +49,6 @@ Symbol to_symbol_or_throw(Node const& node, char const* cmd)
     return *sym;
 }
 
-bool is_variadic_args(Symbol const& sym)
-{
-    return sym.name().size() > 1 && sym.name()[0] == '*';
-}
-
 List to_formal_args_or_throw(Node const& node, char const* cmd)
 {
     auto args = to_list_or_throw(node, cmd);
@@ -57,7 +59,7 @@ List to_formal_args_or_throw(Node const& node, char const* cmd)
         if (!sym.has_value()) {
             throw EvalError(cmd + (": " + std::to_string(car(c))) + " is not a symbol");
         }
-        if (is_variadic_args(*sym) && !cdr(c).empty()) {
+        if (is_variadic_arg(*sym) && !cdr(c).empty()) {
             throw EvalError(cmd + (": " + sym->name()) + " must be the last argument");
         }
     }
@@ -65,54 +67,80 @@ List to_formal_args_or_throw(Node const& node, char const* cmd)
     return args;
 }
 
-Node make_lambda(std::string name, List const& formal_args, List const& lambda_body,
-                 std::shared_ptr<Env> const& outer_env)
-{
-    return Proc(std::move(name), [formal_args, lambda_body, outer_env](List args, Env& env) {
-        auto lambda_env = outer_env->derive_new();
-        auto syms = formal_args;
-        while (!syms.empty()) {
-            auto sym = dynamic_node_cast<Symbol>(car(syms));
-            assert(sym.has_value());
+// Macros expand a call once per call site: expansions are memoized by the
+// cons cell of the call form (see Proc::Core::call_form), so a macro used in a
+// loop is expanded on the first iteration only. The expansion of a call is
+// assumed to depend on the call alone, not on the env it is expanded in; it is
+// made afresh only when the macro is bound anew, as a new proc with a table of
+// its own. Every evaluator expands through the table, analyzed code included
+// (see ExpansionCode), so they all see the same expansion.
+//
+// The table holds the forms it is keyed by, so that their cells are not reused
+// for other calls while they are in it. Entries whose form nothing else holds
+// any more, i.e. whose call site is gone, are pruned when the table doubles.
+class MacroCore final : public Proc::Core {
+public:
+    MacroCore(std::string name, List const& formal_args, Node const& macro_body)
+        : Core{std::move(name)}, _formal_args{formal_args}, _macro_body{macro_body}
+    {}
+
+    // A call without a form to key it by, through Proc::call, is expanded
+    // afresh.
+    Node call(List const& args, Env& env, TailCall& tail) override
+    {
+        tail = TailCall{expand_uncached(args, env), env.shared_from_this()};
+        return Node{};
+    }
 
-            if (is_variadic_args(*sym)) {
-                args = map(args, [&env](Node const& node) { return eval(node, env); });
-                lambda_env->set(sym->name().substr(1), args);
-                args = nil;
-                break;
-            }
+    Node call_form(List const& form, Env& env, TailCall& tail) override
+    {
+        tail = TailCall{expand(form, env), env.shared_from_this()};
+        return Node{};
+    }
 
-            if (args.empty()) {
-                throw EvalError("Proc: too few args");
-            }
+    std::unique_ptr<Code const> analyze(List const& form, std::shared_ptr<Scope const> const& scope) const override;
 
-            auto val = eval(car(args), env);
-            lambda_env->set(sym->name(), val);
-            syms = cdr(syms);
-            args = cdr(args);
+    void trace(ReferenceVisitor& visitor) const override
+    {
+        visitor.visit(_formal_args);
+        visitor.visit(_macro_body);
+        for (auto const& [key, expansion] : _expansions) {
+            visitor.visit(expansion.form);
+            visitor.visit(expansion.expr);
         }
+    }
 
-        if (!args.empty()) {
-            throw EvalError("Proc: too many args");
+    // The expansion of `form`, a call to the macro
+    Node expand(List const& form, Env& env) const
+    {
+        auto const key = form.core().get();
+        if (auto it = _expansions.find(key); it != _expansions.end()) {
+            return it->second.expr;
         }
 
-        Node result;
-        for_each(lambda_body, [&result, lambda_env](auto const& expr) { result = eval(expr, *lambda_env); });
+        auto expr = expand_uncached(cdr(form), env);
+        if (_expansions.size() >= _prune_at) {
+            prune();
+        }
+        _expansions.emplace(key, Expansion{form, expr});
+        return expr;
+    }
 
-        return result;
-    });
-}
+private:
+    struct Expansion {
+        List form;
+        Node expr;
+    };
 
-Proc make_macro(std::string name, List const& formal_args, Node const& macro_body)
-{
-    return Proc(std::move(name), [formal_args, macro_body](List args, Env& env) {
+    Node expand_uncached(List args, Env& env) const
+    {
         auto macro_env = env.derive_new();
-        auto syms = formal_args;
+        auto syms = _formal_args;
         while (!syms.empty()) {
             auto sym = dynamic_node_cast<Symbol>(car(syms));
             assert(sym.has_value());
 
-            if (is_variadic_args(*sym)) {
+            if (is_variadic_arg(*sym)) {
                 macro_env->set(sym->name().substr(1), args);
                 args = nil;
                 break;
@@ -132,96 +160,344 @@ Proc make_macro(std::string name, List const& formal_args, Node const& macro_bod
             throw EvalError("Proc: too many args");
         }
 
-        auto expr = eval(macro_body, *macro_env);
-        return eval(expr, env);
-    });
+        return eval(_macro_body, *macro_env);
+    }
+
+    void prune() const
+    {
+        for (auto it = _expansions.begin(); it != _expansions.end();) {
+            if (it->second.form.core()->use_count() == 1) {
+                it = _expansions.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        _prune_at = std::max(min_prune_at, _expansions.size() * 2);
+    }
+
+    static constexpr std::size_t min_prune_at = 64;
+
+    List const _formal_args;
+    Node const _macro_body;
+    mutable std::unordered_map<List::Core const*, Expansion> _expansions;
+    mutable std::size_t _prune_at = min_prune_at;
+};
+
+// A call to a macro in analyzed code: runs the analyzed expansion of `form`,
+// made on first use. The call site keeps `macro` alive for as long as it runs
+// this code in its place (see Proc::Core::analyze).
+struct ExpansionCode final : Code {
+    ExpansionCode(MacroCore const& m, List f, std::shared_ptr<Scope const> s)
+        : macro{m}, form{std::move(f)}, scope{std::move(s)}
+    {}
+
+    Node run(Env& env, TailCall& tail) const override
+    {
+        if (!_code) {
+            auto expansion = macro.expand(form, env);
+            if (!_code) { // unless expanding got here first
+                _code = analyze(expansion, scope);
+            }
+        }
+        return _code->run(env, tail);
+    }
+
+    void trace(ReferenceVisitor& visitor) const override
+    {
+        visitor.visit(form);
+        if (_code) {
+            _code->trace(visitor);
+        }
+    }
+
+    MacroCore const& macro;
+    List const form;
+    std::shared_ptr<Scope const> const scope;
+
+private:
+    mutable std::unique_ptr<Code const> _code;
+};
+
+std::unique_ptr<Code const> MacroCore::analyze(List const& form, std::shared_ptr<Scope const> const& scope) const
+{
+    return std::make_unique<ExpansionCode>(*this, form, scope);
 }
 
-} // namespace
+Proc make_macro(std::string name, List const& formal_args, Node const& macro_body)
+{
+    return Proc{make_ref<MacroCore>(std::move(name), formal_args, macro_body)};
+}
 
-void set_primitive_procs(Env& env)
+MacroCore const* to_macro(Node const& node)
 {
-    MLISP_DEFUN("atom", [cmd](List args, Env& env) {
-        assert_argc(args, 1, cmd);
-        auto list = dynamic_node_cast<List>(eval(car(args), env));
-        return to_node(!list || list->empty());
-    });
+    auto proc = Proc::from_node(node);
+    return proc ? dynamic_cast<MacroCore const*>(proc->core().get()) : nullptr;
+}
 
-    MLISP_DEFUN("eq", [cmd](List args, Env& env) {
-        assert_argc(args, 2, cmd);
-        auto lhs = eval(car(args), env);
-        auto rhs = eval(cadr(args), env);
-        return to_node(lhs.core() == rhs.core());
-    });
+// Expands the macro calls throughout a form, as bound in the env the form is
+// to be evaluated in. Names bound by the lambdas and definitions around a call
+// shadow the env's bindings, and quoted data is left alone. Subforms without
+// macro calls are kept as they are, cells and all.
+class MacroExpander final {
+public:
+    explicit MacroExpander(Env& env) : _env{env}
+    {}
+
+    Node expand(Node const& form)
+    {
+        auto list = dynamic_node_cast<List>(form);
+        if (!list || list->empty()) {
+            return form;
+        }
 
-    MLISP_DEFUN("car", [cmd](List args, Env& env) {
-        assert_argc(args, 1, cmd);
-        return car(to_list_or_throw(eval(car(args), env), cmd));
-    });
+        auto const op = car(*list);
+        auto const args = cdr(*list);
+        auto const binding = lookup(op);
+        if (!binding) {
+            return expand_each(*list);
+        }
+        if (auto macro = to_macro(*binding)) {
+            return expand(macro->expand(*list, _env));
+        }
 
-    MLISP_DEFUN("cdr", [cmd](List args, Env& env) {
-        assert_argc(args, 1, cmd);
-        return cdr(to_list_or_throw(eval(car(args), env), cmd));
-    });
+        auto proc = dynamic_node_cast<Proc>(*binding);
+        switch (proc ? proc->core()->special_form() : SpecialForm::none) {
+        case SpecialForm::quote:
+            return form;
+        case SpecialForm::cond:
+            return rebuild(*list, map(args, [this](Node const& clause) {
+                               auto exprs = dynamic_node_cast<List>(clause);
+                               return exprs ? Node{expand_each(*exprs)} : clause;
+                           }));
+        case SpecialForm::lambda:
+        case SpecialForm::macro:
+            return expand_lambda(*list);
+        case SpecialForm::define:
+        case SpecialForm::set: {
+            auto expanded = rebuild(*list, cons(car(args), expand_each(cdr(args))));
+            if (auto name = dynamic_node_cast<Symbol>(car(args))) {
+                _bound.push_back(name->id()); // for the rest of the form
+            }
+            return expanded;
+        }
+        case SpecialForm::none:
+            break;
+        }
+        if (auto sym = dynamic_node_cast<Symbol>(op); sym && sym->name() == "quasiquote") {
+            return form;
+        }
+        return expand_each(*list);
+    }
 
-    MLISP_DEFUN("cons", [cmd](List args, Env& env) {
-        assert_argc(args, 2, cmd);
-        auto head = eval(car(args), env);
-        auto tail = to_list_or_throw(eval(cadr(args), env), cmd);
-        return cons(head, tail);
-    });
+private:
+    // The value of `op` in the env, unless it is a name bound around the call.
+    std::optional<Node> lookup(Node const& op) const
+    {
+        auto sym = dynamic_node_cast<Symbol>(op);
+        if (!sym || std::find(_bound.begin(), _bound.end(), sym->id()) != _bound.end()) {
+            return std::nullopt;
+        }
+        return _env.deep_lookup(*sym);
+    }
+
+    // (lambda (formal...) expr...), (macro (formal...) expr)
+    Node expand_lambda(List const& form)
+    {
+        auto const args = cdr(form);
+        auto formal_args = args.empty() ? std::nullopt : dynamic_node_cast<List>(car(args));
+        if (!formal_args) {
+            return form; // left for the call to report
+        }
+
+        auto const outer = _bound.size();
+        for_each(*formal_args, [this](Node const& arg) {
+            if (auto sym = dynamic_node_cast<Symbol>(arg)) {
+                _bound.push_back(sym->id());
+                if (is_variadic_arg(*sym)) {
+                    _bound.push_back(Symbol{sym->name().substr(1)}.id());
+                }
+            }
+        });
+        auto body = expand_each(cdr(args));
+        _bound.resize(outer);
+        return rebuild(form, cons(car(args), body));
+    }
+
+    List expand_each(List const& list)
+    {
+        auto expanded = map(list, [this](Node const& node) { return expand(node); });
+        return same(list, expanded) ? list : expanded;
+    }
+
+    // `form` with `args`, or `form` itself if they are what it has already
+    static List rebuild(List const& form, List const& args)
+    {
+        return same(cdr(form), args) ? form : cons(car(form), args);
+    }
+
+    static bool same(List lhs, List rhs)
+    {
+        for (; !lhs.empty() && !rhs.empty(); lhs = cdr(lhs), rhs = cdr(rhs)) {
+            if (!eq(car(lhs), car(rhs))) {
+                return false;
+            }
+        }
+        return lhs.empty() && rhs.empty();
+    }
 
-    MLISP_DEFUN("cond", [cmd](List args, Env& env) {
-        Node result;
-        while (!args.empty()) {
-            auto clause = to_list_or_throw(car(args), cmd);
-            if (to_bool(eval(car(clause), env))) {
-                result = eval(cadr(clause), env);
+    Env& _env;
+    std::vector<std::uint32_t> _bound; // ids of the names bound around the form
+};
+
+struct CondCode : Code {
+    struct Clause {
+        std::unique_ptr<Code const> test;
+        std::shared_ptr<Code const> branch;
+    };
+
+    Node run(Env& env, TailCall& tail) const override
+    {
+        for (auto const& clause : clauses) {
+            if (to_bool(execute(*clause.test, env))) {
+                tail.env = env.shared_from_this();
+                tail.code = clause.branch;
                 break;
             }
-            args = cdr(args);
         }
-        return result;
-    });
+        return Node{};
+    }
 
-    MLISP_DEFUN("define", [cmd](List args, Env& env) {
-        assert_argc(args, 2, cmd);
+    void trace(ReferenceVisitor& visitor) const override
+    {
+        for (auto const& clause : clauses) {
+            clause.test->trace(visitor);
+            clause.branch->trace(visitor);
+        }
+    }
 
-        auto symbol = to_symbol_or_throw(car(args), cmd);
-        auto value = eval(cadr(args), env);
-        env.set(symbol.name(), value);
-        return value;
-    });
+    std::vector<Clause> clauses;
+};
 
-    MLISP_DEFUN("set!", [cmd](List args, Env& env) {
-        assert_argc(args, 2, cmd);
+std::unique_ptr<Code const> analyze_cond(List args, std::shared_ptr<Scope const> const& scope)
+{
+    auto code = std::make_unique<CondCode>();
+    while (!args.empty()) {
+        auto clause = dynamic_node_cast<List>(car(args));
+        if (!clause) {
+            return nullptr; // left for call() to report if it is reached
+        }
+        code->clauses.push_back({analyze(car(*clause), scope), analyze(cadr(*clause), scope)});
+        args = cdr(args);
+    }
+    return code;
+}
 
-        auto symbol = to_symbol_or_throw(car(args), cmd);
-        auto value = eval(cadr(args), env);
-        if (!env.deep_update(symbol.name(), value)) {
-            throw EvalError("unbound variable: " + symbol.name());
+} // namespace
+
+Node macroexpand(Node form, Env& env)
+{
+    while (auto list = dynamic_node_cast<List>(form)) {
+        auto sym = list->empty() ? std::nullopt : dynamic_node_cast<Symbol>(car(*list));
+        auto binding = sym ? env.deep_lookup(*sym) : std::nullopt;
+        auto macro = binding ? to_macro(*binding) : nullptr;
+        if (!macro) {
+            break;
         }
-        return value;
+        form = macro->expand(*list, env);
+    }
+    return form;
+}
+
+Node macroexpand_all(Node const& form, Env& env)
+{
+    return MacroExpander{env}.expand(form);
+}
+
+void set_primitive_procs(Env& env)
+{
+    MLISP_DEFUN_NATIVE("atom", [/*cmd*/](Node const& node) {
+        auto list = dynamic_node_cast<List>(node);
+        return to_node(!list || list->empty());
     });
 
-    MLISP_DEFUN("lambda", [cmd](List args, Env& env) {
-        assert_argc_min(args, 2, cmd);
+    MLISP_DEFUN_NATIVE("eq", [/*cmd*/](Node const& lhs, Node const& rhs) { return to_node(mll::eq(lhs, rhs)); });
+
+    MLISP_DEFUN_NATIVE("car", [cmd](Node const& list) { return car(to_list_or_throw(list, cmd)); });
 
-        auto formal_args = to_formal_args_or_throw(car(args), cmd);
-        auto lambda_body = cdr(args);
-        auto outer_env = env.shared_from_this();
+    MLISP_DEFUN_NATIVE("cdr", [cmd](Node const& list) { return cdr(to_list_or_throw(list, cmd)); });
 
-        return make_lambda("anonymous", formal_args, lambda_body, outer_env);
+    MLISP_DEFUN_NATIVE("cons", [cmd](Node const& head, Node const& tail) {
+        return cons(head, to_list_or_throw(tail, cmd));
     });
 
-    MLISP_DEFUN("macro", [cmd](List args, Env& /*env*/) {
-        assert_argc_min(args, 2, cmd);
+    env.set("cond", make_special_form(
+                        "cond", SpecialForm::cond,
+                        [](List args, Env& env, TailCall& tail) {
+                            while (!args.empty()) {
+                                auto clause = to_list_or_throw(car(args), "cond");
+                                if (to_bool(eval(car(clause), env))) {
+                                    tail = TailCall{cadr(clause), env.shared_from_this()};
+                                    break;
+                                }
+                                args = cdr(args);
+                            }
+                            return Node{};
+                        },
+                        analyze_cond));
+
+    env.set("define", make_special_form("define", SpecialForm::define,
+                                        [](List const& args, Env& env, TailCall& /*tail*/) {
+                                            auto const cmd = "define";
+                                            assert_argc(args, 2, cmd);
+
+                                            auto symbol = to_symbol_or_throw(car(args), cmd);
+                                            auto value = eval(cadr(args), env);
+                                            env.set(symbol.name(), value);
+                                            return value;
+                                        }));
+
+    env.set("set!", make_special_form("set!", SpecialForm::set,
+                                      [](List const& args, Env& env, TailCall& /*tail*/) {
+                                          auto const cmd = "set!";
+                                          assert_argc(args, 2, cmd);
+
+                                          auto symbol = to_symbol_or_throw(car(args), cmd);
+                                          auto value = eval(cadr(args), env);
+                                          if (!env.deep_update(symbol.name(), value)) {
+                                              throw EvalError("unbound variable: " + symbol.name());
+                                          }
+                                          return value;
+                                      }));
+
+    env.set("lambda", make_special_form("lambda", SpecialForm::lambda,
+                                        [](List args, Env& env, TailCall& /*tail*/) -> Node {
+                                            auto const cmd = "lambda";
+                                            assert_argc_min(args, 2, cmd);
+
+                                            auto formal_args = to_formal_args_or_throw(car(args), cmd);
+                                            auto lambda_body = cdr(args);
+                                            auto outer_env = env.shared_from_this();
+
+                                            return make_lambda("anonymous", formal_args, lambda_body, outer_env);
+                                        }));
+
+    MLISP_DEFUN_NATIVE("macroexpand", [/*cmd*/](Node const& expr, Env& env) { return macroexpand(expr, env); });
+
+    MLISP_DEFUN_NATIVE("macroexpand-all", [/*cmd*/](Node const& expr, Env& env) {
+        return macroexpand_all(expr, env);
+    });
 
-        auto formal_args = to_formal_args_or_throw(car(args), cmd);
-        auto macro_body = cadr(args);
+    env.set("macro", make_special_form("macro", SpecialForm::macro,
+                                       [](List const& args, Env& /*env*/, TailCall& /*tail*/) -> Node {
+                                           auto const cmd = "macro";
+                                           assert_argc_min(args, 2, cmd);
 
-        return make_macro("anonymous", formal_args, macro_body);
-    });
+                                           auto formal_args = to_formal_args_or_throw(car(args), cmd);
+                                           auto macro_body = cadr(args);
+
+                                           return make_macro("anonymous", formal_args, macro_body);
+                                       }));
 }
 
 } // namespace mlisp
\ No newline at end of file
@@ -2,8 +2,16 @@
 
 namespace mll {
 class Env;
+class Node;
 }
 
 namespace mlisp {
 void set_primitive_procs(mll::Env& env);
+
+// Expands `form` for as long as it is a call to a macro bound in `env`.
+mll::Node macroexpand(mll::Node form, mll::Env& env);
+
+// Expands every macro call in `form`, subforms included, but for those in
+// quoted data and those to names bound by lambdas around them.
+mll::Node macroexpand_all(mll::Node const& form, mll::Env& env);
 } // namespace mlisp
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "parser.hpp"
 
 #include <mll/eval.hpp>
+#include <mll/gc.hpp>
 #include <mll/node.hpp>
 #include <mll/print.hpp>
 
@@ -59,6 +60,7 @@ int repl(mll::Env& env)
                 std::cout << "=====> ";
                 mll::print(std::cout, value);
                 std::cout << '\n';
+                mll::GarbageCollector::collect_if_needed();
             }
             catch (mll::ParseError& e) {
                 std::cout << e.what() << '\n';
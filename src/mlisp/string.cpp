@@ -1,6 +1,5 @@
 #include "string.hpp"
 
-#include "argc.hpp"
 #include "bool.hpp"
 
 #include <mll/env.hpp>
@@ -9,10 +8,11 @@
 #include <mll/print.hpp>
 #include <mll/proc.hpp>
 
-#define MLISP_DEFUN(cmd__, func__)                                                                                     \
+// Defines a proc of `func__`, called as a `signature__` (see mll::bind)
+#define MLISP_DEFUN_BOUND(cmd__, signature__, func__)                                                                  \
     do {                                                                                                               \
         auto const cmd = cmd__;                                                                                        \
-        env.set(cmd, Proc{cmd, func__});                                                                               \
+        env.set(cmd, bind<signature__>(cmd, func__));                                                                  \
     } while (0)
 
 namespace mlisp {
@@ -52,15 +52,6 @@ bool is_string(mll::Node const& node)
 {
     return mll::dynamic_node_cast<String>(node).has_value();
 }
-
-String to_string_or_throw(mll::Node const& node, char const* cmd)
-{
-    auto str = mll::dynamic_node_cast<String>(node);
-    if (!str) {
-        throw mll::EvalError(cmd + (": " + std::to_string(node)) + " is not a string.");
-    }
-    return *str;
-}
 } // namespace
 
 void StringPrinter::print(std::ostream& ostream, mll::PrintContext context, std::string const& value)
@@ -77,18 +68,10 @@ void set_string_procs(mll::Env& env)
 {
     using namespace mll;
 
-    MLISP_DEFUN("string?", [cmd](List const& args, Env& env) {
-        assert_argc(args, 1, cmd);
-        return to_node(is_string(eval(car(args), env)));
-    });
-
-    MLISP_DEFUN("string-equal?", [cmd](List const& args, Env& env) {
-        assert_argc(args, 2, cmd);
+    MLISP_DEFUN_BOUND("string?", bool(Node const&), is_string);
 
-        auto const str1 = to_string_or_throw(eval(car(args), env), cmd);
-        auto const str2 = to_string_or_throw(eval(cadr(args), env), cmd);
-        return to_node(str1.value() == str2.value());
-    });
+    MLISP_DEFUN_BOUND("string-equal?", bool(std::string_view, std::string_view),
+                      [](std::string_view lhs, std::string_view rhs) { return lhs == rhs; });
 }
 
 } // namespace mlisp
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <mll/bind.hpp>
 #include <mll/custom.hpp>
 
 #include <string>
+#include <string_view>
 
 namespace mll {
 class Env;
@@ -18,4 +20,21 @@ using String = mll::CustomType<std::string, StringPrinter>;
 
 void set_string_procs(mll::Env& env);
 
-} // namespace mlisp
\ No newline at end of file
+} // namespace mlisp
+
+// Views of string arguments are valid for the duration of the call.
+template <>
+struct mll::NodeConversion<std::string_view> {
+    static constexpr char const* expected = "a string";
+    static std::optional<std::string_view> from_node(Node const& node)
+    {
+        if (auto str = mlisp::String::from_node(node)) {
+            return std::string_view{str->value()};
+        }
+        return std::nullopt;
+    }
+    static Node to_node(std::string_view value)
+    {
+        return mlisp::String{std::string{value}};
+    }
+};
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "number.hpp"
+#include "parser.hpp"
+#include "primitives.hpp"
+
+#include <mll/env.hpp>
+#include <mll/eval.hpp>
+#include <mll/list.hpp>
+#include <mll/print.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+
+namespace {
+
+mll::Node eval_text(char const* text, mll::Env& env)
+{
+    std::istringstream iss{text};
+    mlisp::Parser parser;
+    mll::Node result;
+    while (auto expr = parser.parse(iss)) {
+        result = mll::eval(*expr, env);
+    }
+    return result;
+}
+
+struct EvalModeSetting {
+    explicit EvalModeSetting(mll::EvalMode mode)
+    {
+        mll::set_eval_mode(mode);
+    }
+
+    ~EvalModeSetting()
+    {
+        mll::set_eval_mode(old_mode);
+    }
+
+    mll::EvalMode const old_mode = mll::eval_mode();
+};
+
+} // namespace
+
+TEST_CASE("Closures keep only the bindings they use", "[closure]")
+{
+    auto mode = GENERATE(mll::EvalMode::recursive, mll::EvalMode::stack, mll::EvalMode::bytecode);
+    EvalModeSetting setting{mode};
+
+    auto env = mll::Env::create();
+    mlisp::set_primitive_procs(*env);
+    mlisp::set_number_procs(*env);
+    auto show = [&env](char const* text) { return std::to_string(eval_text(text, *env)); };
+
+    SECTION("arguments the body does not name are let go")
+    {
+        auto const big = mll::cons(mll::nil, mll::nil);
+        env->set("big", big);
+        eval_text("(define keep-tag (lambda (items tag) (lambda () tag)))"
+                  "(define tagged (keep-tag big 'tag))",
+                  *env);
+        env->set("big", mll::nil);
+        REQUIRE(big.core()->use_count() == 1);
+        REQUIRE(show("(tagged)") == "tag");
+    }
+
+    SECTION("closures made in one frame see each other's updates")
+    {
+        eval_text("(define make-pair (lambda (n) (cons (lambda () n) (cons (lambda () (set! n (+ n 1))) '()))))"
+                  "(define pair (make-pair 10))"
+                  "((car (cdr pair)))"
+                  "((car (cdr pair)))",
+                  *env);
+        REQUIRE(show("((car pair))") == "12");
+    }
+
+    SECTION("closures see updates of the frame they were made in")
+    {
+        eval_text("(define z 'global)"
+                  "(define late-set (lambda (x) (define get (lambda () x)) (set! x 'set) (get)))"
+                  "(define late-define (lambda () (define get (lambda () z)) (define z 'local) (get)))",
+                  *env);
+        REQUIRE(show("(late-set 'arg)") == "set");
+        REQUIRE(show("(late-define)") == "local");
+    }
+
+    SECTION("macros called in the body may name other bindings")
+    {
+        eval_text("(define getx (macro () 'x))"
+                  "(define f ((lambda (x) (lambda () (getx))) 5))"
+                  "(define inc (macro () '(set! c (+ c 1))))"
+                  "(define mk (lambda (c) (lambda () (inc))))",
+                  *env);
+        REQUIRE(show("(f)") == "5");
+        REQUIRE(show("((mk 10))") == "11");
+    }
+
+    SECTION("procs called in the body may be rebound to macros later")
+    {
+        eval_text("(define helper (lambda () 'helper))"
+                  "(define c ((lambda (x) (lambda () (helper))) 5))"
+                  "(define helper (macro () 'x))",
+                  *env);
+        REQUIRE(show("(c)") == "5");
+    }
+}
@@ -0,0 +1,106 @@
+#include "number.hpp"
+#include "parser.hpp"
+#include "primitives.hpp"
+
+#include <mll/env.hpp>
+#include <mll/list.hpp>
+#include <mll/eval.hpp>
+#include <mll/print.hpp>
+#include <mll/proc.hpp>
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+
+namespace {
+
+mll::Node eval_text(char const* text, mll::Env& env)
+{
+    std::istringstream iss{text};
+    mlisp::Parser parser;
+    mll::Node result;
+    while (auto expr = parser.parse(iss)) {
+        result = mll::eval(*expr, env);
+    }
+    return result;
+}
+
+struct EvalModeSetting {
+    explicit EvalModeSetting(mll::EvalMode mode)
+    {
+        mll::set_eval_mode(mode);
+    }
+
+    ~EvalModeSetting()
+    {
+        mll::set_eval_mode(old_mode);
+    }
+
+    mll::EvalMode const old_mode = mll::eval_mode();
+};
+
+} // namespace
+
+TEST_CASE("Macros expand a call site once", "[macro]")
+{
+    auto mode = GENERATE(mll::EvalMode::recursive, mll::EvalMode::stack, mll::EvalMode::bytecode);
+    EvalModeSetting setting{mode};
+
+    auto env = mll::Env::create();
+    mlisp::set_primitive_procs(*env);
+    mlisp::set_number_procs(*env);
+
+    auto expansions = 0;
+    env->set("counted", mll::make_applicative_proc("counted", [&expansions](mll::List const& values, mll::Env&) {
+                 ++expansions;
+                 return mll::car(values);
+             }));
+    eval_text("(define my-if (macro (p a b) (counted `(cond (,p ,a) ('t ,b)))))"
+              "(define count-down (lambda (n) (my-if (number-equal? n 0) 'done (count-down (- n 1)))))",
+              *env);
+
+    REQUIRE(std::to_string(eval_text("(count-down 100)", *env)) == "done");
+    REQUIRE(expansions == 1);
+
+    // a macro bound anew expands the same call site anew
+    eval_text("(define my-if (macro (p a b) (counted `(cond (,p ,b) ('t ,a)))))", *env);
+    REQUIRE(std::to_string(eval_text("(count-down 100)", *env)) == "done");
+    REQUIRE(expansions == 2);
+}
+
+TEST_CASE("Macro calls without arguments expand once in every eval mode", "[macro]")
+{
+    auto mode = GENERATE(mll::EvalMode::recursive, mll::EvalMode::stack, mll::EvalMode::bytecode);
+    EvalModeSetting setting{mode};
+
+    auto env = mll::Env::create();
+    mlisp::set_primitive_procs(*env);
+
+    eval_text("(define mode 'first)"
+              "(define pick (macro () (cons 'quote (cons mode '()))))"
+              "(define g (lambda () (pick)))",
+              *env);
+    REQUIRE(std::to_string(eval_text("(g)", *env)) == "first");
+
+    // the call site keeps its expansion until `pick` is bound anew
+    eval_text("(define mode 'second)", *env);
+    REQUIRE(std::to_string(eval_text("(g)", *env)) == "first");
+    eval_text("(define pick (macro () (cons 'quote (cons mode '()))))", *env);
+    REQUIRE(std::to_string(eval_text("(g)", *env)) == "second");
+}
+
+TEST_CASE("macroexpand-all expands macro calls throughout a form", "[macro]")
+{
+    auto env = mll::Env::create();
+    mlisp::set_primitive_procs(*env);
+    eval_text("(define my-if (macro (p a b) `(cond (,p ,a) ('t ,b))))", *env);
+
+    auto show = [&env](char const* text) { return std::to_string(eval_text(text, *env)); };
+    REQUIRE(show("(macroexpand '(my-if x y z))") == "(cond (x y) ('t z))");
+    REQUIRE(show("(macroexpand-all '(lambda (x) (car (my-if x (my-if x 1 2) 3))))") ==
+            "(lambda (x) (car (cond (x (cond (x 1) ('t 2))) ('t 3))))");
+
+    // quoted data and names bound by lambdas are left alone
+    REQUIRE(show("(macroexpand-all ''(my-if x y z))") == "'(my-if x y z)");
+    REQUIRE(show("(macroexpand-all '(lambda (my-if) (my-if x y z)))") == "(lambda (my-if) (my-if x y z))");
+}